@@ -0,0 +1,230 @@
+/*
+ * Assembly Driver Implementation
+ *
+ * This module runs one source file through every assembly stage and
+ * writes its output files. It is shared by the assembler program and
+ * the in-process test runner:
+ * 1. Preprocesses the input file to handle macros
+ * 2. Performs first pass to build symbol table and encode instructions
+ * 3. Performs second pass to resolve symbols and complete encoding
+ * 4. Generates output files (.ob, .ent, .ext)
+ *
+ * All per-file state is released before returning, so files can be
+ * assembled one after another in the same process.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "assemble.h"
+#include "first_pass.h"
+#include "second_pass.h"
+#include "utils.h"
+#include "symbol_table.h"
+#include "writefiles.h"
+#include "preprocessor.h"
+#include "xref.h"
+#include "encoding_cache.h"
+#include "delta.h"
+#include "symmap.h"
+#include "binary_machine_code.h"
+
+#define MAX_FILENAME 256
+
+/* Options from the command line of the assembler or test runner */
+Options options = {FALSE, FALSE, FALSE, FALSE, FALSE};
+
+/*
+ * set_option - Turns on the option named by a command line argument
+ *
+ * Parameters:
+ * arg: Argument, including its leading '-'
+ *
+ * Returns:
+ * Bool: TRUE if the option is known, FALSE otherwise
+ */
+Bool set_option(const char *arg) {
+    if (strcmp(arg, "-x") == 0) {
+        options.xref = TRUE;
+    } else if (strcmp(arg, "-d") == 0) {
+        options.delta = TRUE;
+    } else if (strcmp(arg, "-fpic") == 0) {
+        options.pic = TRUE;
+    } else if (strcmp(arg, "-m") == 0) {
+        options.symmap = TRUE;
+    } else if (strcmp(arg, "--trusted") == 0) {
+        options.trusted = TRUE;
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * assemble_file - Processes a single assembly source file through all assembly stages
+ * 
+ * Parameters:
+ * filename: Name of the assembly source file to process (without extension)
+ * 
+ * Returns:
+ * Bool: TRUE if assembly was successful, FALSE if any errors occurred
+ * 
+ * The function performs these main steps:
+ * 1. Preprocesses the source file to expand macros (.as -> .am)
+ * 2. First pass: builds symbol table and encodes instructions
+ * 3. Second pass: resolves symbols and completes encoding
+ * 4. Generates output files if both passes are successful
+ */
+Bool assemble_file(const char *filename) {
+    FILE *fp;
+    char line_buf[MAX_SOURCE_LINE];
+    SourceLine line;
+    MachineWord *code[MAX_CODE_SIZE] = {NULL};
+    long data[MAX_CODE_SIZE] = {0};
+    long ic = START_IC, dc = 0;
+    long line_num = 1;
+    Bool success = TRUE;
+    char basename[MAX_FILENAME];
+    SymbolTable *symbols;
+    char *input_filename = malloc(strlen(filename) + 4); /* +4 for .am and null terminator */
+    
+    /* Preprocess the source file to expand macros (.as -> .am) */
+    if (!preprocess_file(filename)) {
+        fprintf(stderr, "Error: Preprocessing failed for %s\n", filename);
+        return FALSE;
+    }
+    
+    /* Allocate memory for preprocessed filename (.am extension) */
+    if (!input_filename) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return FALSE;
+    }
+    
+    sprintf(input_filename, "%s.am", filename);
+    
+    /* Open the preprocessed source file for reading */
+    fp = fopen(input_filename, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open file %s\n", input_filename);
+        free(input_filename);
+        return FALSE;
+    }
+    
+    /* Store base filename without extension for output files */
+    strcpy(basename, filename);
+    
+    free(input_filename);
+    
+    /* Initialize symbol table */
+    symbols = create_symbol_table();
+    
+    /* Start collecting cross-references if requested */
+    if (options.xref) xref_begin();
+    
+    /* Initialize line info */
+    line.filename = filename;
+    
+    /* First Pass: Build symbol table and encode instructions */
+    while (fgets(line_buf, MAX_SOURCE_LINE, fp)) {
+        line.num = line_num++;
+        line.text = line_buf;
+        
+        if (!process_line_first_pass(line, &ic, &dc, code, data, symbols)) {
+            success = FALSE;
+            break;
+        }
+    }
+    
+    /* Cached encodings are only valid within the first pass of this file */
+    clear_encoding_cache();
+    
+    /* If first pass successful, update data symbol addresses and perform second pass */
+    if (success) {
+        /* Add IC to each data symbol address (step 1.18-1.19) */
+        long final_ic = ic;  /* Save the final IC */
+        
+        /* Update data symbol addresses to follow the code section */
+        relocate_data_symbols(symbols, final_ic);
+        
+        /* Map labels while local scopes are still complete */
+        if (options.symmap) symmap_collect(symbols, final_ic, final_ic + dc);
+        
+        /* Reset file, line counter and local label scopes */
+        rewind(fp);
+        rewind_scopes(symbols);
+        line_num = 1;
+        ic = START_IC;
+        
+        /* Second Pass */
+        while (fgets(line_buf, MAX_SOURCE_LINE, fp)) {
+            line.num = line_num++;
+            line.text = line_buf;
+            
+            if (!process_line_second_pass(line, &ic, code, symbols)) {
+                success = FALSE;
+                break;
+            }
+        }
+        
+        /* Report relocations removed by position-independent mode
+         * (the count is taken even on failure so it starts at 0 next file) */
+        {
+            long removed = take_pic_count();
+            long remaining = 0;
+            int i;
+            
+            if (success && options.pic) {
+                for (i = 0; i < ic - START_IC; i++) {
+                    if (code[i] && !code[i]->is_instruction &&
+                        code[i]->content.data->are == ARE_RELOCATABLE) {
+                        remaining++;
+                    }
+                }
+                printf("%s: -fpic removed %ld relocations, %ld remaining\n",
+                       filename, removed, remaining);
+            }
+        }
+        
+        /* If both passes successful, write output files */
+        if (success) {
+            PreviousBuild prev;
+            
+            /* Keep the previous build to diff against */
+            if (options.delta) snapshot_previous_build(basename, &prev);
+            
+            success = write_object_file(basename, code, data, ic, dc) &&
+                     write_entry_file(basename, symbols) &&
+                     write_extern_file(basename, symbols) &&
+                     (!options.xref || xref_write(basename, symbols)) &&
+                     (!options.symmap || symmap_write(basename));
+            
+            if (options.delta) {
+                success = write_delta_file(basename, symbols, &prev) && success;
+            }
+        }
+    }
+    
+    /* Cleanup */
+    fclose(fp);
+    
+    /* Free code words */
+    {
+        int i;
+        for (i = 0; i < ic - START_IC; i++) {
+            if (code[i]) {
+                if (code[i]->is_instruction)
+                    free(code[i]->content.code);
+                else
+                    free(code[i]->content.data);
+                free(code[i]);
+            }
+        }
+    }
+    
+    /* Free symbol table, cross-references and symbol map */
+    free_symbol_table(symbols);
+    xref_end();
+    symmap_end();
+    
+    return success;
+}
@@ -0,0 +1,13 @@
+/* Assembly of a single source file through all stages */
+#ifndef ASSEMBLE_H
+#define ASSEMBLE_H
+
+#include "globals.h"
+
+/* Turn on a command line option (-x, -d, -fpic, -m, --trusted), FALSE if unknown */
+Bool set_option(const char *arg);
+
+/* Assemble <filename>.as and write its output files */
+Bool assemble_file(const char *filename);
+
+#endif /* ASSEMBLE_H */
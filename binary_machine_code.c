@@ -72,88 +72,71 @@ DataWord* create_data_word(unsigned are, long value) {
 }
 
 /*
- * get_addressing_mode - Determines addressing mode of operand
+ * get_addressing_mode - Validates an operand and returns its addressing mode
  *
  * Parameters:
- * operand: Operand string to analyze
+ * line: Source line for error messages
+ * operand: Operand text
+ * kind: Operand kind found by the lexer (scan_line)
  *
  * Returns:
- * AddressMode: Type of addressing used
- *   IMMEDIATE (#number)
- *   DIRECT (label)
- *   RELATIVE (&label)
+ * AddressMode: Addressing mode of the operand
+ *   IMMEDIATE (#number or #constant)
+ *   DIRECT (label or .local)
+ *   RELATIVE (&label or &.local)
  *   REGISTER_MODE (r0-r7)
- *   NO_ADDRESSING/INVALID_ADDR for errors
+ *   NO_ADDRESSING if a label operand is not a valid label
+ *   INVALID_ADDR if a number or register is malformed (reported here)
+ *
+ * The kind already tells the addressing mode; this only checks the
+ * number, register or label it names. With --trusted, immediate
+ * numbers are taken as written; registers and labels are still checked.
  */
-AddressMode get_addressing_mode(const char *operand) {
+AddressMode get_addressing_mode(SourceLine line, const char *operand, OperandKind kind) {
     char *endptr;
-    const char *numstr;
-    SourceLine temp_line;
-    
-    if (!operand) return NO_ADDRESSING;
+    const char *label = operand;
     
-    /* Check for immediate addressing (#number) */
-    if (operand[0] == '#') {
-        numstr = operand + 1;
-        
-        /* Check if empty after # */
-        if (!*numstr) {
-            temp_line.num = 0;
-            temp_line.filename = "";
-            temp_line.text = (char*)operand;
+    switch (kind) {
+        case OPERAND_IMMEDIATE:
+            if (options.trusted) return IMMEDIATE;
             
-            print_error(temp_line, "Missing number after #");
-            return NO_ADDRESSING;
-        }
-        
-        /* Attempt to convert to number */
-        strtol(numstr, &endptr, 10);
-        if (*endptr != '\0') {
-            temp_line.num = 0;
-            temp_line.filename = "";
-            temp_line.text = (char*)operand;
+            /* Check if empty after # */
+            if (!operand[1]) {
+                print_error(line, "Missing number after #");
+                return INVALID_ADDR;
+            }
             
-            print_error(temp_line, "Invalid immediate value '%s', must be a valid number", numstr);
-            return NO_ADDRESSING;
-        }
-        return IMMEDIATE;
-    }
-    
-    /* Check for relative addressing (&label) */
-    if (operand[0] == '&') {
-        if (!is_valid_label(operand + 1)) {
-            return NO_ADDRESSING;
-        }
-        return RELATIVE;
-    }
-    
-    /* Check for register (r0-r7) */
-    if (operand[0] == 'r') {
-        if (strlen(operand) != 2) {
-            temp_line.num = 0;
-            temp_line.filename = "";
-            temp_line.text = (char*)operand;
+            /* Number, or a named constant folded in by the first pass */
+            strtol(operand + 1, &endptr, 10);
+            if (*endptr != '\0' && !is_valid_label(operand + 1)) {
+                print_error(line, "Invalid immediate value '%s', must be a valid number", operand + 1);
+                return INVALID_ADDR;
+            }
+            return IMMEDIATE;
             
-            print_error(temp_line, "Invalid register format '%s', must be r0-r7", operand);
-            return INVALID_ADDR;
-        }
-        if (operand[1] >= '0' && operand[1] <= '7') {
+        case OPERAND_REGISTER:
+            if (strlen(operand) != 2) {
+                print_error(line, "Invalid register format '%s', must be r0-r7", operand);
+                return INVALID_ADDR;
+            }
+            if (operand[1] > '7') {
+                print_error(line, "Invalid register number '%c', must be between 0-7", operand[1]);
+                return INVALID_ADDR;
+            }
             return REGISTER_MODE;
-        }
-        /* Invalid register number */
-        temp_line.num = 0;
-        temp_line.filename = "";
-        temp_line.text = (char*)operand;
-        
-        print_error(temp_line, "Invalid register number '%c', must be between 0-7", operand[1]);
-        return INVALID_ADDR;
+            
+        case OPERAND_RELATIVE:
+            label = operand + 1;
+            break;
+            
+        default:
+            break;
     }
     
-    /* If valid label, assume direct addressing */
-    if (is_valid_label(operand)) {
-        return DIRECT;
+    if (!is_valid_label(label) && !is_local_label(label)) {
+        return NO_ADDRESSING;
     }
-    return NO_ADDRESSING;
+    return kind == OPERAND_RELATIVE ? RELATIVE : DIRECT;
 }
 
 /*
@@ -214,87 +197,49 @@ void get_operation_details(const char *op_name, OpCode *op, FuncCode *func) {
  *
  * Parameters:
  * line: Source line to parse
- * start_idx: Starting position in line
- * operands: Array to store extracted operand strings
+ * tokens: Tokens of the line from scan_line
+ * operands: Output: operand strings, in buffers of MAX_SOURCE_LINE
  * count: Pointer to store number of operands found
  * op_name: Operation name (for error messages)
  *
  * Returns:
  * Bool: TRUE if operands parsed successfully, FALSE if error
  *
- * Validates operand count against operation requirements
+ * Validates operand count against operation requirements, except with
+ * --trusted, where the caller's single count check is enough
  */
-Bool parse_operands(SourceLine line, int start_idx, char *operands[2], 
+Bool parse_operands(SourceLine line, const LineTokens *tokens, char operands[][MAX_SOURCE_LINE],
                    int *count, const char *op_name) {
-    int i = start_idx;
-    char buffer[MAX_SOURCE_LINE];
-    int buf_idx;
     OpCode op;
     FuncCode func;
     
-    *count = 0;
-    operands[0] = operands[1] = NULL;
-    
-    skip_whitespace(line.text, &i);
-    
-    /* Parse up to 2 operands */
-    while (line.text[i] && line.text[i] != '\n' && *count < 2) {
-        buf_idx = 0;
-        
-        /* Get operand */
-        while (line.text[i] && !strchr(" ,\t\n", line.text[i]) &&
-               buf_idx < MAX_SOURCE_LINE - 1) {
-            buffer[buf_idx++] = line.text[i++];
-        }
-        buffer[buf_idx] = '\0';
-        
-        if (buf_idx == 0) break;
-        
-        /* Store operand */
-        operands[*count] = str_copy(buffer);
-        (*count)++;
-        
-        /* Skip whitespace and comma */
-        skip_whitespace(line.text, &i);
-        if (line.text[i] == ',') {
-            i++;
-            skip_whitespace(line.text, &i);
-        }
+    /* Copy the operand tokens found by the lexer */
+    for (*count = 0; *count < tokens->operand_count; (*count)++) {
+        copy_token(line.text, tokens->operands[*count], operands[*count]);
     }
     
     /* Validate number of operands */
-    if (line.text[i] && line.text[i] != '\n') {
+    if (tokens->has_excess) {
         if (op_name) {
             print_error(line, "Too many operands for %s", op_name);
         }
-        /* Free allocated memory */
-        if (operands[0]) {
-            free(operands[0]);
-            if (operands[1]) free(operands[1]);
-        }
         return FALSE;
     }
     
+    if (options.trusted) return TRUE;
+    
     /* Check for valid number of operands based on operation type */
     get_operation_details(op_name, &op, &func);
     
     /* Validate zero-operand instructions */
     if ((op == OP_RTS || op == OP_HALT) && *count != 0) {
         print_error(line, "Operation '%s' does not accept any operands", op_name);
-        if (operands[0]) {
-            free(operands[0]);
-            if (operands[1]) free(operands[1]);
-        }
         return FALSE;
     }
     
     /* Validate two-operand instructions */
     if ((op == OP_MOV || op == OP_CMP || op == OP_MATH || op == OP_LEA) && *count != 2) {
         print_error(line, "Operation '%s' requires exactly two operands, got %d", op_name, *count);
-        if (operands[0]) {
-            free(operands[0]);
-            if (operands[1]) free(operands[1]);
-        }
         return FALSE;
     }
     
@@ -4,6 +4,7 @@
 
 #include "globals.h"
 #include "symbol_table.h"
+#include "lexer.h"
 
 /* Maximum operation name length */
 #define MAX_OP_LEN 4
@@ -29,8 +30,8 @@ DataWord* create_data_word(
     long value          /* Word value */
 );
 
-/* Get addressing mode of an operand */
-AddressMode get_addressing_mode(const char *operand);
+/* Validate an operand of a given kind and get its addressing mode */
+AddressMode get_addressing_mode(SourceLine line, const char *operand, OperandKind kind);
 
 /* Get operation details */
 void get_operation_details(
@@ -42,8 +43,8 @@ void get_operation_details(
 /* Parse operands from a line */
 Bool parse_operands(
     SourceLine line,      /* Current line */
-    int start_idx,        /* Where to start parsing */
-    char *operands[2],    /* Output: operand strings */
+    const LineTokens *tokens, /* Tokens of the line from scan_line */
+    char operands[][MAX_SOURCE_LINE], /* Output: operand strings */
     int *count,           /* Output: number of operands */
     const char *op_name   /* Operation name for error messages */
 );
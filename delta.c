@@ -0,0 +1,467 @@
+/*
+ * Delta Image Implementation
+ *
+ * Devices receive new images over a slow link, and most rebuilds change
+ * only a few words. This module describes a new build as a compact set
+ * of patches against the previous one:
+ * 1. The previous .ob/.ent are read before the new ones are written
+ * 2. Changed words are grouped into address ranges and written as patches
+ * 3. The entry table is included only if it changed
+ * 4. Checksums of both images let the apply side verify the result
+ *
+ * Delta File Format (.obd):
+ * - First line: OBD1 <code_size> <data_size> <old_checksum> <new_checksum>
+ * - W <address> <count> <word>...    Replace count words at address
+ * - F <address> <count> <word>       Fill count words at address
+ * - N <count> followed by count "<name> <address>" lines
+ *                                    New entry table (only if changed,
+ *                                    N 0 when the last entry was removed)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delta.h"
+#include "utils.h"
+
+#define DELTA_MAGIC "OBD1"
+
+/* Unchanged words allowed inside one patch before it is split */
+#define MAX_PATCH_GAP 2
+
+/* Minimum run of identical words written as a fill */
+#define MIN_FILL_RUN 4
+
+/*
+ * image_total - Returns the number of words in an image
+ */
+static long image_total(const ObjectImage *image) {
+    return image->code_size + image->data_size;
+}
+
+/*
+ * load_object_image - Reads an object file into memory
+ *
+ * Parameters:
+ * filename: Path of the .ob file
+ * image: Output: decoded image
+ *
+ * Returns:
+ * Bool: TRUE if loaded, FALSE if the file is missing or malformed
+ *
+ * Words missing from the file are left as zero.
+ */
+Bool load_object_image(const char *filename, ObjectImage *image) {
+    FILE *fp;
+    long addr, total;
+    unsigned long word;
+
+    image->code_size = image->data_size = 0;
+    image->words = NULL;
+
+    fp = fopen(filename, "r");
+    if (!fp) return FALSE;
+
+    if (fscanf(fp, "%ld %ld", &image->code_size, &image->data_size) != 2 ||
+        image->code_size < 0 || image->data_size < 0) {
+        fclose(fp);
+        image->code_size = image->data_size = 0;
+        return FALSE;
+    }
+
+    total = image_total(image);
+    image->words = (unsigned long*)safe_malloc((total ? total : 1) * sizeof(unsigned long));
+    memset(image->words, 0, (total ? total : 1) * sizeof(unsigned long));
+
+    while (fscanf(fp, "%ld %lx", &addr, &word) == 2) {
+        if (addr < START_IC || addr >= START_IC + total) {
+            fclose(fp);
+            free_object_image(image);
+            return FALSE;
+        }
+        image->words[addr - START_IC] = word & 0xFFFFFF;
+    }
+
+    fclose(fp);
+    return TRUE;
+}
+
+/*
+ * write_object_image - Writes an image in the object file format
+ *
+ * Parameters:
+ * filename: Path of the .ob file to create
+ * image: Image to write
+ *
+ * Returns:
+ * Bool: TRUE if written, FALSE if the file could not be created
+ *
+ * Like the assembler, writes a temporary file and renames it into
+ * place, so patching a file onto itself never leaves it half written
+ * and the object file gets a new inode (precompiled images check it).
+ */
+Bool write_object_image(const char *filename, const ObjectImage *image) {
+    char temp_name[300];
+    FILE *fp;
+    long addr;
+    Bool ok;
+
+    sprintf(temp_name, "%.250s.tmp", filename);
+    fp = fopen(temp_name, "w");
+    if (!fp) return FALSE;
+
+    fprintf(fp, "%ld %ld\n", image->code_size, image->data_size);
+    for (addr = 0; addr < image_total(image); addr++) {
+        fprintf(fp, "%07ld %06lx\n", addr + START_IC, image->words[addr]);
+    }
+
+    ok = !ferror(fp);
+    fclose(fp);
+
+    if (!ok || rename(temp_name, filename) != 0) {
+        remove(temp_name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * free_object_image - Frees the words of an image
+ */
+void free_object_image(ObjectImage *image) {
+    free(image->words);
+    image->words = NULL;
+    image->code_size = image->data_size = 0;
+}
+
+/*
+ * image_checksum - Computes an Adler-32 checksum of an image
+ *
+ * Parameters:
+ * image: Image to checksum
+ *
+ * Returns:
+ * unsigned long: Checksum over both sizes and every 24-bit word
+ */
+unsigned long image_checksum(const ObjectImage *image) {
+    unsigned long a = 1, b = 0;
+    unsigned long values[2];
+    long i;
+    int k, shift;
+
+    values[0] = (unsigned long)image->code_size;
+    values[1] = (unsigned long)image->data_size;
+
+    for (i = -2; i < image_total(image); i++) {
+        unsigned long word = i < 0 ? values[i + 2] : image->words[i];
+
+        for (k = 0, shift = 16; k < 3; k++, shift -= 8) {
+            a = (a + ((word >> shift) & 0xFF)) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    return (b << 16) | a;
+}
+
+/*
+ * read_text_file - Reads a whole text file into memory
+ *
+ * Parameters:
+ * filename: Path of the file
+ *
+ * Returns:
+ * char*: Null-terminated contents, NULL if the file does not exist
+ */
+char* read_text_file(const char *filename) {
+    FILE *fp;
+    char *text;
+    size_t len = 0, cap = 256, n;
+
+    fp = fopen(filename, "r");
+    if (!fp) return NULL;
+
+    text = (char*)safe_malloc(cap);
+    while ((n = fread(text + len, 1, cap - len - 1, fp)) > 0) {
+        len += n;
+        if (cap - len - 1 == 0) {
+            cap *= 2;
+            text = (char*)safe_realloc(text, cap);
+        }
+    }
+    text[len] = '\0';
+
+    fclose(fp);
+    return text;
+}
+
+/*
+ * snapshot_previous_build - Loads the previous build of a file
+ *
+ * Parameters:
+ * base_name: Base name of the output files
+ * prev: Output: previous image and entry table
+ *
+ * Must be called before the new output files are written. A missing
+ * previous image is treated as empty, so the delta holds every word.
+ */
+void snapshot_previous_build(const char *base_name, PreviousBuild *prev) {
+    char filename[256];
+
+    sprintf(filename, "%s.ob", base_name);
+    load_object_image(filename, &prev->image);
+
+    sprintf(filename, "%s.ent", base_name);
+    prev->entries = read_text_file(filename);
+}
+
+/*
+ * word_changed - Checks if the word at an index differs from the old image
+ */
+static Bool word_changed(const ObjectImage *old_image, const ObjectImage *new_image, long i) {
+    return i >= image_total(old_image) || old_image->words[i] != new_image->words[i];
+}
+
+/*
+ * write_patch - Writes one changed range as write and fill records
+ *
+ * Parameters:
+ * fp: Delta file
+ * image: New image
+ * start: Index of first word in the range
+ * end: Index after the last word in the range
+ *
+ * Runs of at least MIN_FILL_RUN identical words become fill records,
+ * everything else is written word by word.
+ */
+static void write_patch(FILE *fp, const ObjectImage *image, long start, long end) {
+    long i = start, run, pending = start;
+
+    while (i <= end) {
+        /* Length of the run of identical words starting at i */
+        run = 0;
+        if (i < end) {
+            for (run = 1; i + run < end && image->words[i + run] == image->words[i]; run++)
+                ;
+        }
+
+        if (i == end || run >= MIN_FILL_RUN) {
+            /* Flush pending words before the fill (or at the end) */
+            if (pending < i) {
+                long j;
+                fprintf(fp, "W %07ld %ld", pending + START_IC, i - pending);
+                for (j = pending; j < i; j++) {
+                    fprintf(fp, " %06lx", image->words[j]);
+                }
+                fprintf(fp, "\n");
+            }
+            if (i == end) break;
+
+            fprintf(fp, "F %07ld %ld %06lx\n", i + START_IC, run, image->words[i]);
+            i += run;
+            pending = i;
+        } else {
+            i += run;
+        }
+    }
+}
+
+/*
+ * entry_table - Formats the entries of a symbol table like the .ent file
+ *
+ * Parameters:
+ * symbols: Final symbol table
+ * count: Output: number of entries
+ *
+ * Returns:
+ * char*: Entry lines, empty if there are no entries
+ */
+static char* entry_table(SymbolTable *symbols, long *count) {
+    SymbolEntry *entry;
+    char *text;
+    size_t len = 0;
+
+    *count = 0;
+    for (entry = symbols->first; entry; entry = entry->next) {
+        if (entry->type == SYMBOL_ENTRY) {
+            len += strlen(entry->name) + 10;
+            (*count)++;
+        }
+    }
+
+    text = (char*)safe_malloc(len + 1);
+    len = 0;
+    text[0] = '\0';
+    for (entry = symbols->first; entry; entry = entry->next) {
+        if (entry->type == SYMBOL_ENTRY) {
+            sprintf(text + len, "%s %07ld\n", entry->name, entry->address);
+            len += strlen(text + len);
+        }
+    }
+    return text;
+}
+
+/*
+ * write_delta_file - Creates the delta file (.obd) for a new build
+ *
+ * Parameters:
+ * base_name: Base name of the output files
+ * symbols: Final symbol table, the source of the new entry table
+ * prev: Snapshot taken before the new files were written (freed here)
+ *
+ * Returns:
+ * Bool: TRUE if the delta was written, FALSE if error
+ *
+ * The new entry table is taken from the symbol table rather than the
+ * .ent file, which is not written for a build without entries. A .ent
+ * file left by an earlier build is removed then, as obpatch does on
+ * the device, so the next snapshot sees the table the delta described.
+ */
+Bool write_delta_file(const char *base_name, SymbolTable *symbols, PreviousBuild *prev) {
+    char filename[256];
+    FILE *fp;
+    ObjectImage image;
+    char *entries;
+    long i, start, gap, entry_count;
+    Bool success = TRUE;
+
+    /* Load the image that was just written */
+    sprintf(filename, "%s.ob", base_name);
+    if (!load_object_image(filename, &image)) {
+        fprintf(stderr, "Error: Cannot read %s for delta\n", filename);
+        success = FALSE;
+    }
+
+    entries = entry_table(symbols, &entry_count);
+    if (entry_count == 0) {
+        sprintf(filename, "%s.ent", base_name);
+        remove(filename);
+    }
+
+    sprintf(filename, "%s.obd", base_name);
+    fp = success ? fopen(filename, "w") : NULL;
+    if (success && !fp) success = FALSE;
+
+    if (success) {
+        fprintf(fp, "%s %ld %ld %lu %lu\n", DELTA_MAGIC, image.code_size, image.data_size,
+                image_checksum(&prev->image), image_checksum(&image));
+
+        /* Group changed words into ranges, bridging short unchanged gaps */
+        for (i = 0; i < image_total(&image); ) {
+            if (!word_changed(&prev->image, &image, i)) {
+                i++;
+                continue;
+            }
+
+            start = i;
+            for (gap = 0; i < image_total(&image) && gap <= MAX_PATCH_GAP; i++) {
+                gap = word_changed(&prev->image, &image, i) ? 0 : gap + 1;
+            }
+            write_patch(fp, &image, start, i - gap);
+        }
+
+        /* Entry table, only if it changed (a missing file is an empty table) */
+        if (strcmp(prev->entries ? prev->entries : "", entries) != 0) {
+            fprintf(fp, "N %ld\n%s", entry_count, entries);
+        }
+
+        fclose(fp);
+    }
+
+    free_object_image(&image);
+    free_object_image(&prev->image);
+    free(entries);
+    free(prev->entries);
+    prev->entries = NULL;
+    return success;
+}
+
+/*
+ * apply_delta_file - Rebuilds a new image from an old image and a delta
+ *
+ * Parameters:
+ * filename: Path of the .obd file
+ * old_image: Image currently on the device
+ * new_image: Output: patched image
+ * entries: Output: new entry table text, NULL if unchanged,
+ *          empty if every entry was removed
+ *
+ * Returns:
+ * Bool: TRUE if applied and both checksums match, FALSE if error
+ */
+Bool apply_delta_file(const char *filename, const ObjectImage *old_image,
+                      ObjectImage *new_image, char **entries) {
+    FILE *fp;
+    char magic[8], kind[2], name[MAX_SOURCE_LINE];
+    unsigned long old_sum, new_sum, word;
+    long total, addr, count, i;
+
+    *entries = NULL;
+    new_image->words = NULL;
+
+    fp = fopen(filename, "r");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return FALSE;
+    }
+
+    if (fscanf(fp, "%7s %ld %ld %lu %lu", magic, &new_image->code_size,
+               &new_image->data_size, &old_sum, &new_sum) != 5 ||
+        strcmp(magic, DELTA_MAGIC) != 0 ||
+        new_image->code_size < 0 || new_image->data_size < 0) {
+        fprintf(stderr, "Error: %s is not a delta file\n", filename);
+        fclose(fp);
+        return FALSE;
+    }
+
+    if (image_checksum(old_image) != old_sum) {
+        fprintf(stderr, "Error: Delta %s does not apply to this image\n", filename);
+        fclose(fp);
+        return FALSE;
+    }
+
+    /* Start from the old words that are still in range */
+    total = image_total(new_image);
+    new_image->words = (unsigned long*)safe_malloc((total ? total : 1) * sizeof(unsigned long));
+    for (i = 0; i < total; i++) {
+        new_image->words[i] = i < image_total(old_image) ? old_image->words[i] : 0;
+    }
+
+    while (fscanf(fp, "%1s", kind) == 1) {
+        if (kind[0] == 'N') {
+            /* Rebuild entry table text */
+            size_t len = 0;
+
+            if (fscanf(fp, "%ld", &count) != 1 || count < 0) break;
+            *entries = (char*)safe_malloc(count * (MAX_SOURCE_LINE + 10) + 1);
+            (*entries)[0] = '\0';
+            for (i = 0; i < count; i++) {
+                if (fscanf(fp, "%80s %ld", name, &addr) != 2) break;
+                sprintf(*entries + len, "%s %07ld\n", name, addr);
+                len += strlen(*entries + len);
+            }
+            continue;
+        }
+
+        if ((kind[0] != 'W' && kind[0] != 'F') ||
+            fscanf(fp, "%ld %ld", &addr, &count) != 2 ||
+            addr < START_IC || count < 0 || addr - START_IC + count > total) {
+            break;
+        }
+
+        for (i = 0; i < count; i++) {
+            if ((kind[0] == 'W' || i == 0) && fscanf(fp, "%lx", &word) != 1) break;
+            new_image->words[addr - START_IC + i] = word & 0xFFFFFF;
+        }
+    }
+
+    fclose(fp);
+
+    if (image_checksum(new_image) != new_sum) {
+        fprintf(stderr, "Error: Checksum mismatch after applying %s\n", filename);
+        free_object_image(new_image);
+        free(*entries);
+        *entries = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
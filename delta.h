@@ -0,0 +1,46 @@
+/* Delta images for incremental deployment */
+#ifndef DELTA_H
+#define DELTA_H
+
+#include "globals.h"
+#include "symbol_table.h"
+
+/* Decoded contents of an object file (.ob) */
+typedef struct {
+    long code_size;          /* Number of code words */
+    long data_size;          /* Number of data words */
+    unsigned long *words;    /* Code then data words, from address START_IC */
+} ObjectImage;
+
+/* Object and entry files of the previous build */
+typedef struct {
+    ObjectImage image;       /* Previous image (empty if none existed) */
+    char *entries;           /* Previous .ent text, NULL if none */
+} PreviousBuild;
+
+/* Load an object file, returns FALSE if missing or malformed */
+Bool load_object_image(const char *filename, ObjectImage *image);
+
+/* Write an image in object file format */
+Bool write_object_image(const char *filename, const ObjectImage *image);
+
+/* Free the words of an image */
+void free_object_image(ObjectImage *image);
+
+/* Checksum of an image (sizes and words) */
+unsigned long image_checksum(const ObjectImage *image);
+
+/* Read a whole text file, returns NULL if missing */
+char* read_text_file(const char *filename);
+
+/* Remember <base_name>.ob/.ent before they are overwritten */
+void snapshot_previous_build(const char *base_name, PreviousBuild *prev);
+
+/* Compare the new .ob and entries with the snapshot and write <base_name>.obd */
+Bool write_delta_file(const char *base_name, SymbolTable *symbols, PreviousBuild *prev);
+
+/* Apply a delta file to an image, producing the new image and entries */
+Bool apply_delta_file(const char *filename, const ObjectImage *old_image,
+                      ObjectImage *new_image, char **entries);
+
+#endif /* DELTA_H */
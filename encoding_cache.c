@@ -0,0 +1,130 @@
+/*
+ * Encoding Cache Implementation
+ *
+ * Generated sources repeat the same instruction text many times. This
+ * module remembers how each distinct instruction line was encoded by the
+ * first pass so a repeated line can be stamped into the code image
+ * without parsing its operation and operands again:
+ * 1. The instruction text (after the label) is normalized into a key
+ * 2. The key maps to the instruction word fields and its extra words
+ * 3. Extra words are either absolute values (immediates) or fixup slots
+ *    left for the second pass (direct/relative operands)
+ *
+ * The cache is a fixed-size hash table with chaining and lives for the
+ * first pass of one source file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "encoding_cache.h"
+#include "utils.h"
+
+#define CACHE_BUCKETS 1024
+
+/* Cache entry */
+typedef struct cache_entry {
+    char *key;                  /* Normalized instruction text */
+    EncodedLine encoded;        /* Stored encoding */
+    struct cache_entry *next;   /* Next entry in bucket */
+} CacheEntry;
+
+static CacheEntry *buckets[CACHE_BUCKETS];
+
+/*
+ * hash_key - Computes the bucket for a key (djb2 hash)
+ */
+static unsigned hash_key(const char *key) {
+    unsigned long hash = 5381;
+
+    while (*key) {
+        hash = hash * 33 + (unsigned char)*key++;
+    }
+    return (unsigned)(hash % CACHE_BUCKETS);
+}
+
+/*
+ * normalize_instruction - Builds the cache key for an instruction
+ *
+ * Parameters:
+ * text: Instruction text starting at the operation name
+ * key: Output buffer (at least MAX_SOURCE_LINE characters)
+ *
+ * Runs of spaces and tabs become one space, whitespace next to commas
+ * and at the end of the line is dropped. Texts with the same key parse
+ * to the same operation and operands.
+ */
+void normalize_instruction(const char *text, char *key) {
+    int i = 0, k = 0;
+    Bool pending_space = FALSE;
+
+    while (text[i] && text[i] != '\n' && k < MAX_SOURCE_LINE - 2) {
+        if (text[i] == ' ' || text[i] == '\t') {
+            pending_space = TRUE;
+        } else {
+            if (pending_space && k > 0 && text[i] != ',' && key[k - 1] != ',') {
+                key[k++] = ' ';
+            }
+            pending_space = FALSE;
+            key[k++] = text[i];
+        }
+        i++;
+    }
+    key[k] = '\0';
+}
+
+/*
+ * lookup_encoding - Finds a cached encoding
+ *
+ * Parameters:
+ * key: Normalized instruction text
+ *
+ * Returns:
+ * const EncodedLine*: Cached encoding, NULL if not cached
+ */
+const EncodedLine* lookup_encoding(const char *key) {
+    CacheEntry *entry;
+
+    for (entry = buckets[hash_key(key)]; entry; entry = entry->next) {
+        if (strcmp(entry->key, key) == 0) {
+            return &entry->encoded;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * store_encoding - Adds an encoding to the cache
+ *
+ * Parameters:
+ * key: Normalized instruction text
+ * encoded: Encoding to copy into the cache
+ */
+void store_encoding(const char *key, const EncodedLine *encoded) {
+    unsigned bucket = hash_key(key);
+    CacheEntry *entry = (CacheEntry*)safe_malloc(sizeof(CacheEntry));
+
+    entry->key = str_copy(key);
+    entry->encoded = *encoded;
+    entry->next = buckets[bucket];
+    buckets[bucket] = entry;
+}
+
+/*
+ * clear_encoding_cache - Frees all cached encodings
+ *
+ * Called after the first pass of each file so encodings never carry
+ * over between source files.
+ */
+void clear_encoding_cache(void) {
+    int i;
+    CacheEntry *entry, *next;
+
+    for (i = 0; i < CACHE_BUCKETS; i++) {
+        for (entry = buckets[i]; entry; entry = next) {
+            next = entry->next;
+            free(entry->key);
+            free(entry);
+        }
+        buckets[i] = NULL;
+    }
+}
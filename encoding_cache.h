@@ -0,0 +1,35 @@
+/* Cache of encoded instruction lines */
+#ifndef ENCODING_CACHE_H
+#define ENCODING_CACHE_H
+
+#include "globals.h"
+
+/* Maximum number of extra words after an instruction word */
+#define MAX_EXTRA_WORDS 2
+
+/* Encoding of one instruction line, minus its label */
+typedef struct {
+    OpCode op;                              /* Operation code */
+    FuncCode func;                          /* Function code */
+    AddressMode src_mode;                   /* Source addressing mode */
+    AddressMode dest_mode;                  /* Destination addressing mode */
+    RegNum src_reg;                         /* Source register */
+    RegNum dest_reg;                        /* Destination register */
+    int extra_count;                        /* Number of extra words */
+    Bool extra_resolved[MAX_EXTRA_WORDS];   /* TRUE: absolute value, FALSE: fixup slot */
+    long extra_value[MAX_EXTRA_WORDS];      /* Value of absolute extra words */
+} EncodedLine;
+
+/* Build the cache key for instruction text (label already skipped) */
+void normalize_instruction(const char *text, char *key);
+
+/* Find a cached encoding, NULL if the key was never stored */
+const EncodedLine* lookup_encoding(const char *key);
+
+/* Store an encoding under a key */
+void store_encoding(const char *key, const EncodedLine *encoded);
+
+/* Free all cached encodings */
+void clear_encoding_cache(void);
+
+#endif /* ENCODING_CACHE_H */
@@ -5,7 +5,7 @@
  * During the first pass, the assembler:
  * 1. Builds the symbol table by processing labels
  * 2. Encodes instructions and their operands
- * 3. Processes directives (.data, .string, .extern, .entry)
+ * 3. Processes directives (.data, .string, .extern, .entry, .equ)
  * 4. Calculates addresses for code (IC) and data (DC) segments
  */
 #include <stdio.h>
@@ -17,10 +17,20 @@
 #include "utils.h"
 #include "instructions.h"
 #include "symbol_table.h"
+#include "xref.h"
+#include "encoding_cache.h"
+#include "lexer.h"
 
 /* Forward declarations of internal functions */
-static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord **code);
-static void handle_extra_words(MachineWord **code, long *ic, char *operand, OpCode opcode);
+static void add_label(SourceLine line, SymbolTable *symbols, const char *name, long addr, SymbolType type);
+static Bool process_code_line(SourceLine line, const LineTokens *tokens, long *ic,
+                              MachineWord **code, SymbolTable *symbols);
+static Bool handle_extra_words(SourceLine line, MachineWord **code, long *ic, const char *operand,
+                               AddressMode mode, OpCode opcode, SymbolTable *symbols);
+static void stamp_encoding(const EncodedLine *encoded, long *ic, MachineWord **code);
+static int operand_count(OpCode opcode);
+static void cache_encoding(const char *key, InstructionWord *inst, long ic_start,
+                           long ic, MachineWord **code);
 
 /*
  * process_line_first_pass - Processes a single line during the first pass
@@ -37,51 +47,56 @@ static void handle_extra_words(MachineWord **code, long *ic, char *operand, OpCo
  * Bool: TRUE if line processed successfully, FALSE if error occurred
  * 
  * This function:
- * 1. Processes labels and adds them to symbol table
- * 2. Handles directives (.data, .string, .extern, .entry)
+ * 1. Processes labels and adds them to symbol table (local labels to
+ *    the scope of the last global label)
+ * 2. Handles directives (.data, .string, .extern, .entry, .equ)
  * 3. Processes and encodes instructions
  * 4. Updates IC and DC counters accordingly
  */
 Bool process_line_first_pass(SourceLine line, long *ic, long *dc, 
                            MachineWord **code, long *data, SymbolTable *symbols) {
-    int index = 0;
+    int index;
     char symbol[MAX_SOURCE_LINE];
     Directive dir;
+    LineTokens tokens;
+    Bool is_local = FALSE;
     
-    /* Skip whitespace */
-    skip_whitespace(line.text, &index);
+    /* Split the line into label, keyword and operands */
+    scan_line(line.text, &tokens);
     
     /* Skip empty or comment lines */
-    if (!line.text[index] || line.text[index] == '\n' || line.text[index] == ';') {
+    if (tokens.is_empty) {
         return TRUE;
     }
     
+    symbol[0] = '\0';
+    
     /* Check for label */
-    if (get_label(line, symbol)) {
+    if (tokens.has_label) {
+        copy_token(line.text, tokens.label, symbol);
+        is_local = (symbol[0] == '.');
         
         /* Invalid label name */
-        if (!is_valid_label(symbol)) {
+        if (is_local ? !is_local_label(symbol) : !is_valid_label(symbol)) {
             print_error(line, "Invalid label name: %s", symbol);
             return FALSE;
         }
         
-        /* Skip label definition in source */
-        while (line.text[index] != ':') index++;
-        index++;
-        skip_whitespace(line.text, &index);
-        
-        /* Check if label already exists */
-        if (find_symbol(symbols, symbol)) {
+        /* Check if label already exists (in its scope, for local labels) */
+        if (is_local ? find_local_symbol(symbols, symbol) != NULL : find_symbol(symbols, symbol) != NULL) {
             print_error(line, "Label %s already defined", symbol);
             return FALSE;
         }        
     }
     
+    /* Continue after the label */
+    index = tokens.body;
+    
     /* Empty line after label */
     if (!line.text[index]) return TRUE;
     
     /* Check for directive */
-    dir = get_instruction_type(line, &index);
+    dir = get_instruction_type(line, &tokens, &index);
     if (dir == DIR_ERROR) return FALSE;
     
     skip_whitespace(line.text, &index);
@@ -90,7 +105,7 @@ Bool process_line_first_pass(SourceLine line, long *ic, long *dc,
     if (dir != DIR_NONE) {
         /* Add symbol to table for .data/.string */
         if ((dir == DIR_DATA || dir == DIR_STRING) && symbol[0]) {
-            add_symbol(symbols, symbol, *dc, SYMBOL_DATA);
+            add_label(line, symbols, symbol, *dc, SYMBOL_DATA);
         }
         
         /* Process each directive type */
@@ -101,6 +116,8 @@ Bool process_line_first_pass(SourceLine line, long *ic, long *dc,
                 return process_data_inst(line, index, data, dc);
             case DIR_EXTERN:
                 return process_extern_inst(line, index, symbols);
+            case DIR_EQU:
+                return process_equ_inst(line, &tokens, symbol, symbols);
             case DIR_ENTRY:
                 if (symbol[0]) {
                     print_error(line, "Cannot define label for .entry directive");
@@ -115,9 +132,33 @@ Bool process_line_first_pass(SourceLine line, long *ic, long *dc,
     
     /* Handle code line */
     if (symbol[0]) {
-        add_symbol(symbols, symbol, *ic, SYMBOL_CODE);
+        add_label(line, symbols, symbol, *ic, SYMBOL_CODE);
+    }
+    return process_code_line(line, &tokens, ic, code, symbols);
+}
+
+/*
+ * add_label - Adds a label defined on a code or data line
+ *
+ * Parameters:
+ * line: Source line defining the label
+ * symbols: Symbol table
+ * name: Label name
+ * addr: Current IC (code) or DC (data)
+ * type: SYMBOL_CODE or SYMBOL_DATA
+ *
+ * Local labels go to the current scope. A global label is added to the
+ * global table and opens a new scope for the local labels after it.
+ */
+static void add_label(SourceLine line, SymbolTable *symbols, const char *name, long addr, SymbolType type) {
+    if (name[0] == '.') {
+        add_local_symbol(symbols, name, addr, type);
+        return;
     }
-    return process_code_line(line, index, ic, code);
+    
+    add_symbol(symbols, name, addr, type);
+    open_scope(symbols, name);
+    xref_add(XREF_DEF, name, line.num, 0);
 }
 
 /*
@@ -125,9 +166,10 @@ Bool process_line_first_pass(SourceLine line, long *ic, long *dc,
  * 
  * Parameters:
  * line: Source line to process
- * index: Current position in the line
+ * tokens: Tokens of the line from scan_line
  * ic: Pointer to instruction counter
  * code: Array to store encoded machine code
+ * symbols: Symbol table for constant lookup
  * 
  * Returns:
  * Bool: TRUE if instruction encoded successfully, FALSE if error occurred
@@ -137,28 +179,37 @@ Bool process_line_first_pass(SourceLine line, long *ic, long *dc,
  * 2. Validates operand count and addressing modes
  * 3. Creates instruction words with appropriate encoding
  * 4. Handles additional words for operands as needed
+ *
+ * Lines whose text was already encoded in this file are stamped from the
+ * encoding cache instead of being parsed again.
  */
-static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord **code) {
-    char op[MAX_OP_LEN + 1];                /* Operation name buffer */
-    char *operands[2] = {NULL, NULL};       /* Array to store operand strings */
+static Bool process_code_line(SourceLine line, const LineTokens *tokens, long *ic,
+                              MachineWord **code, SymbolTable *symbols) {
+    char op[MAX_SOURCE_LINE];               /* Operation name buffer */
+    char operands[2][MAX_SOURCE_LINE];      /* Operand strings */
     OpCode opcode;                          /* Operation code (type of instruction) */
     FuncCode func;                          /* Function code for specific operation */
     InstructionWord *inst;                  /* Encoded instruction word */
-    int i, op_count;                        /* Loop counter and operand count */
+    int op_count;                           /* Operand count */
     MachineWord *word;                      /* Machine word for storing in code array */
     long ic_start;                          /* Starting IC for calculating instruction length */
     AddressMode src_mode = NO_ADDRESSING;   /* Addressing mode of source operand */
     AddressMode dest_mode = NO_ADDRESSING;  /* Addressing mode of destination operand */
     RegNum src_reg = 0;                     /* Register number for source operand (0 default) */
     RegNum dest_reg = 0;                    /* Register number for destination operand (0 default) */
+    char key[MAX_SOURCE_LINE];              /* Encoding cache key */
+    const EncodedLine *cached;              /* Cached encoding of identical text */
     
-    /* Get operation name */
-    for (i = 0; i < MAX_OP_LEN && line.text[index] && 
-        line.text[index] != ' ' && line.text[index] != '\t' && 
-        line.text[index] != '\n'; i++, index++) {
-        op[i] = line.text[index];
+    /* Reuse the encoding of an identical instruction */
+    normalize_instruction(line.text + tokens->body, key);
+    cached = lookup_encoding(key);
+    if (cached) {
+        stamp_encoding(cached, ic, code);
+        return TRUE;
     }
-    op[i] = '\0';
+    
+    /* Get operation name */
+    copy_token(line.text, tokens->keyword, op);
     
     /* Get operation details */
     get_operation_details(op, &opcode, &func);
@@ -169,23 +220,24 @@ static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord
     }
     
     /* Parse operands */
-    if (!parse_operands(line, index, operands, &op_count, op)) {
+    if (!parse_operands(line, tokens, operands, &op_count, op)) {
         return FALSE;
     }
 
-    /* Validate operand count for single-operand instructions */
-    if (((opcode == OP_SINGLE) || /* CLR/NOT/INC/DEC */
-         (opcode == OP_JUMPS) ||  /* JMP/BNE/JSR */
-         (opcode == OP_RED) || 
-         (opcode == OP_PRN)) && 
-        op_count != 1) {
-        print_error(line, "Operation '%s' requires exactly one operand, got %d", op, op_count);
-        if (op_count > 0) {
-            free(operands[0]);
-            if (op_count > 1) {
-                free(operands[1]);
-            }
+    /* Trusted input: one count check for every operation */
+    if (options.trusted) {
+        if (op_count != operand_count(opcode)) {
+            print_error(line, "Operation '%s' requires %d operands, got %d",
+                        op, operand_count(opcode), op_count);
+            return FALSE;
         }
+    } else if (((opcode == OP_SINGLE) || /* CLR/NOT/INC/DEC */
+                (opcode == OP_JUMPS) ||  /* JMP/BNE/JSR */
+                (opcode == OP_RED) || 
+                (opcode == OP_PRN)) && 
+               op_count != 1) {
+        /* Validate operand count for single-operand instructions */
+        print_error(line, "Operation '%s' requires exactly one operand, got %d", op, op_count);
         return FALSE;
     }
     
@@ -204,7 +256,7 @@ static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord
             src_reg = 0;
             
             /* Destination is the operand */
-            dest_mode = get_addressing_mode(operands[0]);
+            dest_mode = get_addressing_mode(line, operands[0], tokens->operand_kinds[0]);
             
             /* Set destination register if it's a register */
             if (dest_mode == REGISTER_MODE) {
@@ -218,7 +270,7 @@ static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord
             dest_reg = 0;
             
             /* Source is the operand */
-            src_mode = get_addressing_mode(operands[0]);
+            src_mode = get_addressing_mode(line, operands[0], tokens->operand_kinds[0]);
             
             /* Set source register if it's a register */
             if (src_mode == REGISTER_MODE) {
@@ -229,8 +281,8 @@ static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord
         }
     } else if (op_count == 2) {
         /* Two-operand instruction */
-        src_mode = get_addressing_mode(operands[0]);
-        dest_mode = get_addressing_mode(operands[1]);
+        src_mode = get_addressing_mode(line, operands[0], tokens->operand_kinds[0]);
+        dest_mode = get_addressing_mode(line, operands[1], tokens->operand_kinds[1]);
         
         /* Set register values */
         if (src_mode == REGISTER_MODE) {
@@ -248,10 +300,6 @@ static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord
     
     /* Check for invalid addressing modes */
     if (src_mode == INVALID_ADDR || dest_mode == INVALID_ADDR) {
-        if (op_count > 0) {
-            free(operands[0]);
-            if (op_count > 1) free(operands[1]);
-        }
         return FALSE;
     }
     
@@ -270,50 +318,153 @@ static Bool process_code_line(SourceLine line, int index, long *ic, MachineWord
     
     /* Handle additional words for operands */
     if (op_count > 0) {
-        handle_extra_words(code, ic, operands[0], opcode);
-        free(operands[0]);
+        /* A lone operand of prn is the source; of any other, the destination */
+        Bool words_ok = handle_extra_words(line, code, ic, operands[0],
+                                           op_count > 1 || opcode == OP_PRN ? src_mode : dest_mode,
+                                           opcode, symbols);
         
-        if (op_count > 1) {
-            handle_extra_words(code, ic, operands[1], opcode);
-            free(operands[1]);
+        if (words_ok && op_count > 1) {
+            words_ok = handle_extra_words(line, code, ic, operands[1], dest_mode, opcode, symbols);
+        }
+        
+        if (!words_ok) {
+            /* Keep the instruction length consistent for cleanup */
+            code[ic_start - START_IC]->is_instruction = (*ic) - ic_start;
+            return FALSE;
         }
     }
     
     /* Set instruction length */
     code[ic_start - START_IC]->is_instruction = (*ic) - ic_start;
+    
+    /* Cache the encoding unless an operand was reported as invalid */
+    if ((op_count < 1 || (src_mode != NO_ADDRESSING && dest_mode != NO_ADDRESSING)) &&
+        (opcode == OP_JUMPS || (src_mode != RELATIVE && dest_mode != RELATIVE))) {
+        cache_encoding(key, inst, ic_start, *ic, code);
+    }
     return TRUE;
 }
 
+/*
+ * stamp_encoding - Writes a cached encoding into the code image
+ *
+ * Parameters:
+ * encoded: Cached encoding of the instruction
+ * ic: Pointer to instruction counter
+ * code: Array to store encoded machine code
+ *
+ * Absolute extra words are recreated with their cached value, fixup
+ * slots are reserved for the second pass just like a fresh encoding.
+ */
+static void stamp_encoding(const EncodedLine *encoded, long *ic, MachineWord **code) {
+    MachineWord *word;
+    int i;
+    
+    word = (MachineWord*)safe_malloc(sizeof(MachineWord));
+    word->is_instruction = 1 + encoded->extra_count;
+    word->content.code = create_instruction_word(encoded->op, encoded->func,
+                                                 encoded->src_mode, encoded->dest_mode,
+                                                 encoded->src_reg, encoded->dest_reg);
+    code[(*ic)++ - START_IC] = word;
+    
+    for (i = 0; i < encoded->extra_count; i++) {
+        if (encoded->extra_resolved[i]) {
+            word = (MachineWord*)safe_malloc(sizeof(MachineWord));
+            word->is_instruction = 0;
+            word->content.data = create_data_word(ARE_ABSOLUTE, encoded->extra_value[i]);
+            code[*ic - START_IC] = word;
+        }
+        (*ic)++;
+    }
+}
+
+/*
+ * cache_encoding - Stores a freshly encoded instruction in the cache
+ *
+ * Parameters:
+ * key: Normalized instruction text
+ * inst: Encoded instruction word
+ * ic_start: Address of the instruction word
+ * ic: Address after the last extra word
+ * code: Code image holding the extra words
+ *
+ * Extra words already present are immediates; empty slots are
+ * direct/relative operands that the second pass fills in.
+ */
+static void cache_encoding(const char *key, InstructionWord *inst, long ic_start,
+                           long ic, MachineWord **code) {
+    EncodedLine encoded;
+    MachineWord *word;
+    int i;
+    
+    encoded.op = (OpCode)inst->op;
+    encoded.func = (FuncCode)inst->func;
+    encoded.src_mode = (AddressMode)inst->src_mode;
+    encoded.dest_mode = (AddressMode)inst->dest_mode;
+    encoded.src_reg = (RegNum)inst->src_reg;
+    encoded.dest_reg = (RegNum)inst->dest_reg;
+    encoded.extra_count = (int)(ic - ic_start - 1);
+    
+    if (encoded.extra_count > MAX_EXTRA_WORDS) return;
+    
+    for (i = 0; i < encoded.extra_count; i++) {
+        word = code[ic_start + 1 + i - START_IC];
+        encoded.extra_resolved[i] = word ? TRUE : FALSE;
+        encoded.extra_value[i] = word ? (long)word->content.data->value : 0;
+    }
+    
+    store_encoding(key, &encoded);
+}
+
 /*
  * handle_extra_words - Creates additional words needed for operands
  * 
  * Parameters:
+ * line: Source line for error messages
  * code: Array to store machine code
  * ic: Pointer to instruction counter
  * operand: Operand string to process
+ * mode: Addressing mode of the operand (from get_addressing_mode)
  * opcode: Operation code for validation
+ * symbols: Symbol table for constant lookup
+ * 
+ * Returns:
+ * Bool: FALSE if an immediate names an undefined constant, TRUE otherwise
  * 
  * This function:
- * 1. Processes immediate values and encodes them
+ * 1. Processes immediate values (numbers or .equ constants) and encodes them
  * 2. Reserves space for labels (resolved in second pass)
  * 3. Handles relative addressing for jump instructions
  * 4. Updates instruction counter for additional words
  */
-static void handle_extra_words(MachineWord **code, long *ic, char *operand, OpCode opcode) {
-    AddressMode mode = get_addressing_mode(operand);
+static Bool handle_extra_words(SourceLine line, MachineWord **code, long *ic, const char *operand,
+                               AddressMode mode, OpCode opcode, SymbolTable *symbols) {
     MachineWord *word;
     
-    /* Skip invalid addressing modes and registers */
-    if (mode == INVALID_ADDR) {
-        return;  /* Error already printed in get_addressing_mode */
-    }
-    
     /* Handle valid addressing modes (except registers which are encoded in instruction) */
     if (mode != NO_ADDRESSING && mode != REGISTER_MODE) {
         if (mode == IMMEDIATE) {
             /* Immediate value - encode now */
             char *ptr;
-            long value = strtol(operand + 1, &ptr, 10);
+            long value;
+            
+            if (is_valid_label(operand + 1)) {
+                /* Fold a constant defined earlier with .equ */
+                SymbolEntry *constant = find_symbol(symbols, operand + 1);
+                
+                if (!constant) {
+                    print_error(line, "Undefined constant: %s (constants must be defined before use)",
+                                operand + 1);
+                    return FALSE;
+                }
+                if (constant->type != SYMBOL_CONST) {
+                    print_error(line, "Symbol %s is not a constant", operand + 1);
+                    return FALSE;
+                }
+                value = constant->address;
+            } else {
+                value = strtol(operand + 1, &ptr, 10);
+            }
             
             word = (MachineWord*)safe_malloc(sizeof(MachineWord));
             word->is_instruction = 0;
@@ -334,14 +485,39 @@ static void handle_extra_words(MachineWord **code, long *ic, char *operand, OpCo
                 SourceLine temp;
                 temp.num = 0;
                 temp.filename = "";
-                temp.text = operand;
+                temp.text = (char*)operand;
                 
                 print_error(temp, "Relative addressing mode can only be used with jump instructions (jmp, bne, jsr)");
-                return;
+                return TRUE;  /* Reported as an error by the second pass */
             }
             
             /* Reserve space for the relative address (distance) */
             (*ic)++;
         }
     }
+    return TRUE;
+}
+
+/*
+ * operand_count - Returns the number of operands an operation takes
+ *
+ * Parameters:
+ * opcode: Operation code
+ *
+ * Returns:
+ * int: 0, 1 or 2
+ */
+static int operand_count(OpCode opcode) {
+    switch (opcode) {
+        case OP_MOV:
+        case OP_CMP:
+        case OP_MATH:
+        case OP_LEA:
+            return 2;
+        case OP_RTS:
+        case OP_HALT:
+            return 0;
+        default:
+            return 1;
+    }
 }
@@ -15,7 +15,7 @@ typedef enum {
 
 /* Addressing modes */
 typedef enum {
-    IMMEDIATE = 0,   /* #value */
+    IMMEDIATE = 0,   /* #value or #constant */
     DIRECT = 1,      /* label */
     RELATIVE = 2,    /* label[offset] */
     REGISTER_MODE = 3,/* r0-r7 */
@@ -109,6 +109,7 @@ typedef enum {
     DIR_EXTERN,
     DIR_ENTRY,
     DIR_STRING,
+    DIR_EQU,
     DIR_NONE,
     DIR_ERROR
 } Directive;
@@ -120,4 +121,15 @@ typedef struct {
     char* text;      /* Line content */
 } SourceLine;
 
+/* Command line options, shared by all files assembled in one run */
+typedef struct {
+    Bool xref;       /* -x: write cross-reference index (.xrf) */
+    Bool delta;      /* -d: write delta against the previous build (.obd) */
+    Bool pic;        /* -fpic: encode jumps to local code labels as relative */
+    Bool symmap;     /* -m: write an address-to-symbol map (.sym) */
+    Bool trusted;    /* --trusted: input is machine-generated, skip re-validation */
+} Options;
+
+extern Options options;
+
 #endif /* GLOBALS_H */
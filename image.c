@@ -0,0 +1,316 @@
+/*
+ * Precompiled Image Implementation
+ *
+ * This module lets many simulator instances start on the same program
+ * without each one parsing the object file and decoding its own copy:
+ * 1. The object file is decoded once and written as a precompiled
+ *    image file (.obi) in the host's native word layout
+ * 2. Instances map the image instead of reading it - the code section
+ *    read-only and shared, the data section private and copy-on-write
+ * 3. Identical pages are shared by every instance through the page
+ *    cache until an instance writes to its data
+ *
+ * File Format:
+ * - Header (ImageHeader) at offset 0
+ * - Code words (unsigned int) at code_offset
+ * - Data words (unsigned int) at data_offset
+ * Both sections start on an IMAGE_ALIGN boundary so they can be
+ * mapped separately.
+ *
+ * The header records the identity of the object file it was built
+ * from, so load_cached_image can tell a stale cache from a current one
+ * without reading the object file: inode, size, and modification and
+ * status-change times to the nanosecond. Writing a file always updates
+ * its status-change time, which cannot be set back, so an in-place
+ * rewrite of the same size is caught too. The assembler and obpatch
+ * also write object files through a rename, which changes the inode.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "image.h"
+#include "delta.h"
+#include "utils.h"
+
+#define IMAGE_MAGIC "OBI2"
+#define IMAGE_BYTE_ORDER 0x01020304U   /* Reads back differently on other hosts */
+#define IMAGE_ALIGN 4096L              /* Section alignment, a multiple of the page size */
+
+/* Identity of an object file - changes whenever the file is written */
+typedef struct {
+    unsigned long inode;
+    long size;
+    long mtime, mtime_nsec;      /* Last modification */
+    long ctime, ctime_nsec;      /* Last status change */
+} SourceIdentity;
+
+/* Image file header, in native layout */
+typedef struct {
+    char magic[4];               /* IMAGE_MAGIC */
+    unsigned int byte_order;     /* IMAGE_BYTE_ORDER */
+    unsigned int header_size;    /* sizeof(ImageHeader) */
+    unsigned int word_size;      /* sizeof(unsigned int) */
+    long code_size;              /* Number of code words */
+    long data_size;              /* Number of data words */
+    long code_offset;            /* File offset of the code words */
+    long data_offset;            /* File offset of the data words */
+    unsigned long checksum;      /* image_checksum of the object file */
+    SourceIdentity source;       /* Object file the image was built from */
+} ImageHeader;
+
+/*
+ * get_identity - Fills in the identity of a file from its status
+ */
+static void get_identity(const struct stat *st, SourceIdentity *id) {
+    memset(id, 0, sizeof(SourceIdentity));
+    id->inode = (unsigned long)st->st_ino;
+    id->size = (long)st->st_size;
+    id->mtime = (long)st->st_mtim.tv_sec;
+    id->mtime_nsec = (long)st->st_mtim.tv_nsec;
+    id->ctime = (long)st->st_ctim.tv_sec;
+    id->ctime_nsec = (long)st->st_ctim.tv_nsec;
+}
+
+/*
+ * align_up - Rounds a file offset up to the section alignment
+ */
+static long align_up(long offset) {
+    return (offset + IMAGE_ALIGN - 1) / IMAGE_ALIGN * IMAGE_ALIGN;
+}
+
+/*
+ * write_words - Writes image words in the native word layout
+ *
+ * Parameters:
+ * fp: Output file
+ * words: Decoded words
+ * count: Number of words
+ * pos: Current file offset, advanced past the words
+ */
+static void write_words(FILE *fp, const unsigned long *words, long count, long *pos) {
+    long i;
+
+    for (i = 0; i < count; i++) {
+        unsigned int word = (unsigned int)words[i];
+
+        fwrite(&word, sizeof(word), 1, fp);
+    }
+    *pos += count * (long)sizeof(unsigned int);
+}
+
+/*
+ * pad_to - Writes zero bytes up to a file offset
+ */
+static void pad_to(FILE *fp, long offset, long *pos) {
+    for (; *pos < offset; (*pos)++) {
+        fputc(0, fp);
+    }
+}
+
+/*
+ * build_image_file - Writes the precompiled image of an object file
+ *
+ * Parameters:
+ * ob_filename: Path of the .ob file
+ * image_filename: Path of the .obi file to create
+ *
+ * Returns:
+ * Bool: TRUE if written, FALSE if the object file is missing or
+ *       malformed or the image could not be created
+ *
+ * The image is written to a temporary file and renamed into place, so
+ * instances starting concurrently never map a partial image.
+ */
+Bool build_image_file(const char *ob_filename, const char *image_filename) {
+    ObjectImage image;
+    ImageHeader header;
+    struct stat st;
+    char temp_name[256];
+    FILE *fp;
+    long pos = 0;
+    Bool ok;
+
+    if (stat(ob_filename, &st) != 0 || !load_object_image(ob_filename, &image)) {
+        return FALSE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, 4);
+    header.byte_order = IMAGE_BYTE_ORDER;
+    header.header_size = sizeof(ImageHeader);
+    header.word_size = sizeof(unsigned int);
+    header.code_size = image.code_size;
+    header.data_size = image.data_size;
+    header.code_offset = align_up((long)sizeof(ImageHeader));
+    header.data_offset = align_up(header.code_offset +
+                                  image.code_size * (long)sizeof(unsigned int));
+    header.checksum = image_checksum(&image);
+    get_identity(&st, &header.source);
+
+    sprintf(temp_name, "%.200s.%ld.tmp", image_filename, (long)getpid());
+    fp = fopen(temp_name, "wb");
+    if (!fp) {
+        free_object_image(&image);
+        return FALSE;
+    }
+
+    fwrite(&header, sizeof(header), 1, fp);
+    pos = sizeof(header);
+    pad_to(fp, header.code_offset, &pos);
+    write_words(fp, image.words, image.code_size, &pos);
+    pad_to(fp, header.data_offset, &pos);
+    write_words(fp, image.words + image.code_size, image.data_size, &pos);
+
+    ok = !ferror(fp);
+    fclose(fp);
+    free_object_image(&image);
+
+    if (!ok || rename(temp_name, image_filename) != 0) {
+        remove(temp_name);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * map_image_file - Maps an image, optionally checking it is current
+ *
+ * Parameters:
+ * image_filename: Path of the .obi file
+ * source: Object file status to match, NULL to accept any image
+ *
+ * Returns:
+ * MappedImage*: Mapped image, NULL if missing, malformed, built on a
+ *               host with another word layout, or stale
+ */
+static MappedImage* map_image_file(const char *image_filename, const struct stat *source) {
+    MappedImage *image;
+    ImageHeader header;
+    struct stat st;
+    SourceIdentity id;
+    size_t code_len, data_len;
+    long page_size = sysconf(_SC_PAGESIZE);
+    int fd;
+
+    fd = open(image_filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &st) != 0 ||
+        read(fd, &header, sizeof(header)) != (long)sizeof(header) ||
+        memcmp(header.magic, IMAGE_MAGIC, 4) != 0 ||
+        header.byte_order != IMAGE_BYTE_ORDER ||
+        header.header_size != sizeof(ImageHeader) ||
+        header.word_size != sizeof(unsigned int) ||
+        header.code_size < 0 || header.data_size < 0 ||
+        header.code_offset % IMAGE_ALIGN != 0 || header.data_offset % IMAGE_ALIGN != 0 ||
+        page_size <= 0 || IMAGE_ALIGN % page_size != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    code_len = (size_t)header.code_size * sizeof(unsigned int);
+    data_len = (size_t)header.data_size * sizeof(unsigned int);
+
+    /* Sections must lie inside the file, and the source must not have changed */
+    if (header.code_offset + (long)code_len > (long)st.st_size ||
+        header.data_offset + (long)data_len > (long)st.st_size ||
+        (source && (get_identity(source, &id),
+                    memcmp(&id, &header.source, sizeof(SourceIdentity)) != 0))) {
+        close(fd);
+        return NULL;
+    }
+
+    image = (MappedImage*)safe_malloc(sizeof(MappedImage));
+    memset(image, 0, sizeof(MappedImage));
+    image->code_size = header.code_size;
+    image->data_size = header.data_size;
+    image->checksum = header.checksum;
+
+    /* Code: shared by every instance, never written */
+    if (code_len) {
+        image->code_map = mmap(NULL, code_len, PROT_READ, MAP_SHARED, fd,
+                               (off_t)header.code_offset);
+        if (image->code_map == MAP_FAILED) image->code_map = NULL;
+        image->code_map_len = code_len;
+        image->code = (const unsigned int*)image->code_map;
+    }
+
+    /* Data: shared until an instance writes to a page */
+    if (data_len) {
+        image->data_map = mmap(NULL, data_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                               (off_t)header.data_offset);
+        if (image->data_map == MAP_FAILED) image->data_map = NULL;
+        image->data_map_len = data_len;
+        image->data = (unsigned int*)image->data_map;
+    }
+
+    close(fd);
+
+    if ((code_len && !image->code_map) || (data_len && !image->data_map)) {
+        unmap_image(image);
+        return NULL;
+    }
+    return image;
+}
+
+/*
+ * map_image - Maps a precompiled image file
+ *
+ * Parameters:
+ * image_filename: Path of the .obi file
+ *
+ * Returns:
+ * MappedImage*: Mapped image, NULL if missing or malformed
+ */
+MappedImage* map_image(const char *image_filename) {
+    return map_image_file(image_filename, NULL);
+}
+
+/*
+ * load_cached_image - Maps the image of an object file through its cache
+ *
+ * Parameters:
+ * ob_filename: Path of the .ob file
+ *
+ * Returns:
+ * MappedImage*: Mapped image, NULL if the object file cannot be loaded
+ *
+ * The cache is the .obi file next to the object file. It is used as is
+ * when it was built from the current object file, and rebuilt first
+ * otherwise - only the first instance after a rebuild pays for decoding.
+ */
+MappedImage* load_cached_image(const char *ob_filename) {
+    char image_filename[256];
+    struct stat source;
+    MappedImage *image;
+    size_t len = strlen(ob_filename);
+
+    if (stat(ob_filename, &source) != 0) return NULL;
+
+    if (len > 3 && strcmp(ob_filename + len - 3, ".ob") == 0) len -= 3;
+    if (len > sizeof(image_filename) - 5) return NULL;
+    memcpy(image_filename, ob_filename, len);
+    strcpy(image_filename + len, ".obi");
+
+    image = map_image_file(image_filename, &source);
+    if (image) return image;
+
+    if (!build_image_file(ob_filename, image_filename)) return NULL;
+    return map_image_file(image_filename, &source);
+}
+
+/*
+ * unmap_image - Unmaps an image and frees its handle
+ */
+void unmap_image(MappedImage *image) {
+    if (!image) return;
+
+    if (image->code_map) munmap(image->code_map, image->code_map_len);
+    if (image->data_map) munmap(image->data_map, image->data_map_len);
+    free(image);
+}
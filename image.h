@@ -0,0 +1,33 @@
+/* Precompiled object images shared between simulator instances */
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+#include "globals.h"
+
+/* Decoded image mapped from a precompiled image file (.obi) */
+typedef struct {
+    const unsigned int *code;    /* Code words, shared read-only */
+    unsigned int *data;          /* Data words, private copy-on-write */
+    long code_size;              /* Number of code words */
+    long data_size;              /* Number of data words */
+    unsigned long checksum;      /* Checksum of the object file image */
+    void *code_map;              /* Code mapping (NULL if no code) */
+    size_t code_map_len;
+    void *data_map;              /* Data mapping (NULL if no data) */
+    size_t data_map_len;
+} MappedImage;
+
+/* Decode an object file and write it as a precompiled image */
+Bool build_image_file(const char *ob_filename, const char *image_filename);
+
+/* Map a precompiled image, returns NULL if missing or malformed */
+MappedImage* map_image(const char *image_filename);
+
+/* Map the image of <ob_filename>, rebuilding the cache if it is stale */
+MappedImage* load_cached_image(const char *ob_filename);
+
+/* Unmap an image */
+void unmap_image(MappedImage *image);
+
+#endif /* IMAGE_H */
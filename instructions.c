@@ -2,7 +2,7 @@
  * Assembly Instruction Handling Implementation
  *
  * This module handles all assembly instruction processing including:
- * 1. Processing directives (.data, .string, .entry, .extern)
+ * 1. Processing directives (.data, .string, .entry, .extern, .equ)
  * 2. Validating instruction operands
  * 3. Converting numeric values
  * 4. Building the data image
@@ -18,21 +18,24 @@
 #include "utils.h"
 #include "symbol_table.h"
 #include "binary_machine_code.h"  /* For ARE_ABSOLUTE definition */
+#include "xref.h"
 
 /*
  * get_instruction_type - Identifies the type of directive in a source line
  *
  * Parameters:
  * line: The source line to examine
- * index: Pointer to current position in line (updated after directive)
+ * tokens: Tokens of the line from scan_line
+ * index: Output: position right after the directive name
  *
  * Returns:
  * Directive: Type of directive found (DIR_NONE if not a directive,
  *           DIR_ERROR if invalid directive)
  *
- * Recognizes: .data, .string, .entry, .extern directives
+ * Recognizes: .data, .string, .entry, .extern, .equ directives.
+ * The keyword token must match a directive name exactly.
  */
-Directive get_instruction_type(SourceLine line, int *index) {
+Directive get_instruction_type(SourceLine line, const LineTokens *tokens, int *index) {
     struct {
         const char *name;
         Directive type;
@@ -41,24 +44,68 @@ Directive get_instruction_type(SourceLine line, int *index) {
         {".string", DIR_STRING},
         {".entry", DIR_ENTRY},
         {".extern", DIR_EXTERN},
+        {".equ", DIR_EQU},
         {NULL, DIR_NONE}
     };
+    char keyword[MAX_SOURCE_LINE];
     int i;
     
-    if (line.text[*index] != '.') {
+    *index = tokens->keyword.start + tokens->keyword.len;
+    
+    if (line.text[tokens->keyword.start] != '.') {
         return DIR_NONE;
     }
     
+    copy_token(line.text, tokens->keyword, keyword);
     for (i = 0; directives[i].name; i++) {
-        int len = str_len(directives[i].name);
-        if (strncmp(line.text + *index, directives[i].name, len) == 0) {
-            *index += len;
+        if (strcmp(keyword, directives[i].name) == 0) {
             return directives[i].type;
         }
     }
+    
+    print_error(line, "Unknown directive: %s", keyword);
     return DIR_ERROR;
 }
 
+/*
+ * process_data_trusted - Processes a .data directive from trusted input
+ *
+ * Parameters:
+ * line: Source line containing the .data directive
+ * start_idx: Starting index after .data directive
+ * data_img: Array to store processed data values
+ * dc: Pointer to data counter (updated as values are stored)
+ *
+ * Returns:
+ * Bool: TRUE if directive processed successfully, FALSE if error
+ *
+ * Converts each number with a single strtol call. Only a missing number
+ * or text left at the end of the line is reported.
+ */
+static Bool process_data_trusted(SourceLine line, int start_idx, long *data_img, long *dc) {
+    char *start = line.text + start_idx;
+    char *end;
+    
+    for (;;) {
+        data_img[*dc] = strtol(start, &end, 10);
+        if (end == start) {
+            print_error(line, "Invalid number in .data directive");
+            return FALSE;
+        }
+        (*dc)++;
+        
+        while (*end == ' ' || *end == '\t') end++;
+        if (*end != ',') break;
+        start = end + 1;
+    }
+    
+    if (*end && *end != '\n') {
+        print_error(line, "Unexpected content after .data values");
+        return FALSE;
+    }
+    return TRUE;
+}
+
 /*
  * process_data_inst - Processes a .data directive and builds data image
  *
@@ -81,6 +128,10 @@ Bool process_data_inst(SourceLine line, int start_idx, long *data_img, long *dc)
     long value;
     int idx;
     
+    if (options.trusted) {
+        return process_data_trusted(line, start_idx, data_img, dc);
+    }
+    
     skip_whitespace(line.text, &i);
     
     /* Check for empty data directive */
@@ -256,6 +307,7 @@ Bool process_extern_inst(SourceLine line, int start_idx, SymbolTable* symbols) {
     
     /* Add to symbol table */
     add_symbol(symbols, label, 0, SYMBOL_EXTERN);
+    xref_add(XREF_EXTERN, label, line.num, 0);
     
     /* Check for extra content */
     skip_whitespace(line.text, &i);
@@ -266,6 +318,59 @@ Bool process_extern_inst(SourceLine line, int start_idx, SymbolTable* symbols) {
     return TRUE;
 }
 
+/*
+ * process_equ_inst - Processes an .equ directive
+ *
+ * Parameters:
+ * line: Source line containing the .equ directive
+ * tokens: Tokens of the line from scan_line (the value is its operand)
+ * name: Label of the line, naming the constant
+ * symbols: Symbol table to store the constant
+ *
+ * Returns:
+ * Bool: TRUE if constant defined successfully, FALSE if error
+ *
+ * Adds the constant with type SYMBOL_CONST. Constants take no data
+ * word; the first pass folds them into immediate operands (#name).
+ */
+Bool process_equ_inst(SourceLine line, const LineTokens *tokens, const char *name, SymbolTable *symbols) {
+    char num_str[MAX_SOURCE_LINE];
+    Bool success;
+    long value;
+    
+    /* Constant must be named by a global label */
+    if (!name[0]) {
+        print_error(line, "Missing name for .equ constant");
+        return FALSE;
+    }
+    if (name[0] == '.') {
+        print_error(line, "Constant name cannot be a local label: %s", name);
+        return FALSE;
+    }
+    
+    if (tokens->operand_count == 0) {
+        print_error(line, "Missing value for .equ constant %s", name);
+        return FALSE;
+    }
+    
+    /* The value is the only operand */
+    copy_token(line.text, tokens->operands[0], num_str);
+    value = get_number(num_str, &success);
+    if (!success) {
+        print_error(line, "Invalid constant value '%s'", num_str);
+        return FALSE;
+    }
+    
+    if (tokens->operand_count > 1 || tokens->has_excess) {
+        print_error(line, "Unexpected content after constant value");
+        return FALSE;
+    }
+    
+    add_symbol(symbols, name, value, SYMBOL_CONST);
+    xref_add(XREF_DEF, name, line.num, 0);
+    return TRUE;
+}
+
 /*
  * process_entry_inst - Processes an .entry directive (during second pass)
  *
@@ -4,9 +4,10 @@
 
 #include "globals.h"
 #include "symbol_table.h"
+#include "lexer.h"
 
-/* Find instruction type from line starting at index */
-Directive get_instruction_type(SourceLine line, int *index);
+/* Find directive type from the line's keyword token */
+Directive get_instruction_type(SourceLine line, const LineTokens *tokens, int *index);
 
 /* Process .data instruction */
 Bool process_data_inst(SourceLine line, int start_idx, long *data_img, long *dc);
@@ -17,6 +18,9 @@ Bool process_string_inst(SourceLine line, int start_idx, long *data_img, long *d
 /* Process .extern instruction (first pass) */
 Bool process_extern_inst(SourceLine, int, SymbolTable*);
 
+/* Process .equ instruction (first pass) */
+Bool process_equ_inst(SourceLine line, const LineTokens *tokens, const char *name, SymbolTable *symbols);
+
 /* Process .entry instruction (second pass) */
 Bool process_entry_inst(SourceLine, int, SymbolTable*);
 
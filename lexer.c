@@ -0,0 +1,223 @@
+/*
+ * Line Lexer Implementation
+ *
+ * This module finds the structure of a source line in a single
+ * left-to-right scan, so the passes no longer rescan the line from the
+ * start for each part:
+ * 1. Every character is mapped to a class through a 256-entry table
+ * 2. A DFA transition table, indexed by state and class, drives the scan
+ * 3. State changes mark where the label, keyword and operand tokens
+ *    start and end, and where comments and the end of line are
+ * 4. Each operand gets its kind from its first character when it
+ *    starts, so the passes validate operands without classifying them
+ *
+ * Token boundaries follow the assembler syntax rules:
+ * - The first token is a label if it ends with ':'
+ * - The keyword (operation or directive) ends at whitespace
+ * - Operands are separated by whitespace and at most one comma;
+ *   a second comma or a third operand stops the scan as excess text
+ */
+#include <stdio.h>
+#include "lexer.h"
+
+/* Character classes */
+typedef enum {
+    CC_END,        /* '\0' */
+    CC_SPACE,      /* ' ' and '\t' */
+    CC_NEWLINE,    /* '\n' */
+    CC_COLON,      /* ':' */
+    CC_COMMA,      /* ',' */
+    CC_SEMI,       /* ';' */
+    CC_WORD,       /* Any other character */
+    CC_COUNT
+} CharClass;
+
+/* Scanner states (terminal states last) */
+typedef enum {
+    ST_LEAD,           /* Leading whitespace */
+    ST_FIRST,          /* First token - label or keyword */
+    ST_AFTER_LABEL,    /* Whitespace after "label:" */
+    ST_KEYWORD,        /* Keyword after a label */
+    ST_OPS,            /* Whitespace after the keyword */
+    ST_OPERAND,        /* Inside an operand */
+    ST_AFTER_OPERAND,  /* Whitespace after an operand */
+    ST_AFTER_COMMA,    /* Whitespace after a separating comma */
+    ST_EMPTY,          /* Blank or comment line */
+    ST_DONE,           /* End of line reached */
+    ST_EXCESS          /* Stopped before the end of line */
+} LexState;
+
+#define E CC_END
+#define S CC_SPACE
+#define N CC_NEWLINE
+#define C CC_COLON
+#define M CC_COMMA
+#define Q CC_SEMI
+#define W CC_WORD
+
+/* Character class of every byte value */
+static const unsigned char char_class[256] = {
+    E, W, W, W, W, W, W, W, W, S, N, W, W, W, W, W,  /* 0x00 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0x10 */
+    S, W, W, W, W, W, W, W, W, W, W, W, M, W, W, W,  /* 0x20 */
+    W, W, W, W, W, W, W, W, W, W, C, Q, W, W, W, W,  /* 0x30 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0x40 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0x50 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0x60 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0x70 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0x80 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0x90 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0xA0 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0xB0 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0xC0 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0xD0 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W,  /* 0xE0 */
+    W, W, W, W, W, W, W, W, W, W, W, W, W, W, W, W   /* 0xF0 */
+};
+
+#undef E
+#undef S
+#undef N
+#undef C
+#undef M
+#undef Q
+#undef W
+
+/* Transition table - columns: END, SPACE, NEWLINE, COLON, COMMA, SEMI, WORD */
+static const unsigned char transitions[ST_EMPTY][CC_COUNT] = {
+    /* ST_LEAD */
+    {ST_EMPTY, ST_LEAD, ST_EMPTY, ST_AFTER_LABEL, ST_FIRST, ST_EMPTY, ST_FIRST},
+    /* ST_FIRST */
+    {ST_DONE, ST_OPS, ST_DONE, ST_AFTER_LABEL, ST_FIRST, ST_FIRST, ST_FIRST},
+    /* ST_AFTER_LABEL */
+    {ST_DONE, ST_AFTER_LABEL, ST_DONE, ST_KEYWORD, ST_KEYWORD, ST_KEYWORD, ST_KEYWORD},
+    /* ST_KEYWORD */
+    {ST_DONE, ST_OPS, ST_DONE, ST_KEYWORD, ST_KEYWORD, ST_KEYWORD, ST_KEYWORD},
+    /* ST_OPS */
+    {ST_DONE, ST_OPS, ST_DONE, ST_OPERAND, ST_EXCESS, ST_OPERAND, ST_OPERAND},
+    /* ST_OPERAND */
+    {ST_DONE, ST_AFTER_OPERAND, ST_DONE, ST_OPERAND, ST_AFTER_COMMA, ST_OPERAND, ST_OPERAND},
+    /* ST_AFTER_OPERAND */
+    {ST_DONE, ST_AFTER_OPERAND, ST_DONE, ST_OPERAND, ST_AFTER_COMMA, ST_OPERAND, ST_OPERAND},
+    /* ST_AFTER_COMMA */
+    {ST_DONE, ST_AFTER_COMMA, ST_DONE, ST_OPERAND, ST_EXCESS, ST_OPERAND, ST_OPERAND}
+};
+
+/*
+ * operand_kind - Returns the kind of an operand from its first characters
+ *
+ * Parameters:
+ * text: Operand text, at its first character
+ */
+static OperandKind operand_kind(const char *text) {
+    switch (text[0]) {
+        case '#':
+            return OPERAND_IMMEDIATE;
+        case '&':
+            return OPERAND_RELATIVE;
+        case 'r':
+            if (text[1] >= '0' && text[1] <= '9') return OPERAND_REGISTER;
+            break;
+        default:
+            break;
+    }
+    return OPERAND_LABEL;
+}
+
+/*
+ * scan_line - Splits a source line into its tokens
+ *
+ * Parameters:
+ * text: Line text (may end with '\n')
+ * tokens: Output: label, keyword and operand tokens, with operand kinds
+ *
+ * Reads each character once; an operand's kind also peeks at the
+ * character after its first. Token boundaries are the points where the
+ * DFA enters or leaves the FIRST, KEYWORD and OPERAND states.
+ */
+void scan_line(const char *text, LineTokens *tokens) {
+    LexState state = ST_LEAD, next;
+    Token first;
+    int i = 0;
+
+    tokens->is_empty = FALSE;
+    tokens->has_label = FALSE;
+    tokens->label.start = tokens->label.len = 0;
+    tokens->body = 0;
+    tokens->keyword.start = tokens->keyword.len = 0;
+    tokens->operand_count = 0;
+    tokens->has_excess = FALSE;
+    first.start = first.len = 0;
+
+    for (;; i++) {
+        next = (LexState)transitions[state][char_class[(unsigned char)text[i]]];
+        if (next == state) continue;
+
+        /* Close the token being left */
+        if (state == ST_FIRST) {
+            first.len = i - first.start;
+            if (next == ST_AFTER_LABEL) {
+                tokens->label = first;
+                tokens->has_label = TRUE;
+            } else {
+                tokens->keyword = first;
+            }
+        } else if (state == ST_KEYWORD) {
+            tokens->keyword.len = i - tokens->keyword.start;
+        } else if (state == ST_OPERAND) {
+            tokens->operands[tokens->operand_count - 1].len =
+                i - tokens->operands[tokens->operand_count - 1].start;
+        }
+
+        /* Open the token being entered */
+        if (next == ST_FIRST) {
+            first.start = i;
+            tokens->body = i;
+        } else if (next == ST_AFTER_LABEL && state == ST_LEAD) {
+            /* ':' with no name before it - empty label */
+            tokens->label.start = i;
+            tokens->has_label = TRUE;
+        } else if (next == ST_KEYWORD) {
+            tokens->keyword.start = i;
+            tokens->body = i;
+        } else if (next == ST_OPERAND) {
+            if (tokens->operand_count == MAX_LINE_OPERANDS) {
+                next = ST_EXCESS;
+            } else {
+                tokens->operands[tokens->operand_count].start = i;
+                tokens->operand_kinds[tokens->operand_count] = operand_kind(text + i);
+                tokens->operand_count++;
+            }
+        }
+
+        if (next >= ST_EMPTY) break;
+        state = next;
+    }
+
+    /* Label with nothing after it - body starts at the end of line */
+    if (state == ST_AFTER_LABEL) {
+        tokens->body = i;
+    }
+    if (tokens->keyword.len == 0) {
+        tokens->keyword.start = tokens->body;
+    }
+    tokens->is_empty = (next == ST_EMPTY);
+    tokens->has_excess = (next == ST_EXCESS);
+}
+
+/*
+ * copy_token - Copies a token into a null-terminated buffer
+ *
+ * Parameters:
+ * text: Line text the token was scanned from
+ * token: Token span
+ * buf: Output buffer (at least MAX_SOURCE_LINE characters)
+ */
+void copy_token(const char *text, Token token, char *buf) {
+    int i;
+
+    for (i = 0; i < token.len && i < MAX_SOURCE_LINE - 1; i++) {
+        buf[i] = text[token.start + i];
+    }
+    buf[i] = '\0';
+}
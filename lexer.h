@@ -0,0 +1,43 @@
+/* Line lexer - splits a source line into label, keyword and operands */
+#ifndef LEXER_H
+#define LEXER_H
+
+#include "globals.h"
+
+/* Maximum number of operand tokens collected per line */
+#define MAX_LINE_OPERANDS 2
+
+/* Span of a token in the line text */
+typedef struct {
+    int start;      /* Index of first character */
+    int len;        /* Number of characters */
+} Token;
+
+/* Operand kind, from the first characters of the operand */
+typedef enum {
+    OPERAND_LABEL,       /* Label or .local - direct addressing */
+    OPERAND_IMMEDIATE,   /* '#' - number or constant */
+    OPERAND_RELATIVE,    /* '&' - label */
+    OPERAND_REGISTER     /* 'r' followed by a digit */
+} OperandKind;
+
+/* Tokens of one source line */
+typedef struct {
+    Bool is_empty;                       /* Blank or comment line */
+    Bool has_label;                      /* Line starts with "label:" */
+    Token label;                         /* Label name, without ':' */
+    int body;                            /* Index of first character after the label */
+    Token keyword;                       /* Operation or directive name (len 0 if none) */
+    int operand_count;                   /* Number of operand tokens */
+    Token operands[MAX_LINE_OPERANDS];   /* Operand tokens */
+    OperandKind operand_kinds[MAX_LINE_OPERANDS]; /* Kind of each operand */
+    Bool has_excess;                     /* Text left after the last operand */
+} LineTokens;
+
+/* Scan a line once, left to right, filling in its tokens */
+void scan_line(const char *text, LineTokens *tokens);
+
+/* Copy a token into a buffer of size MAX_SOURCE_LINE */
+void copy_token(const char *text, Token token, char *buf);
+
+#endif /* LEXER_H */
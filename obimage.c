@@ -0,0 +1,77 @@
+/*
+ * Precompiled Image Tool
+ *
+ * Builds (or refreshes) the precompiled image of object files, so
+ * simulator instances started later only map it:
+ *   obimage file1.ob [file2.ob ...]
+ *
+ * Each image is mapped back and compared word for word with the
+ * object file before it is reported.
+ */
+#include <stdio.h>
+#include "image.h"
+#include "delta.h"
+
+/*
+ * check_image - Compares a mapped image with its object file
+ *
+ * Returns:
+ * Bool: TRUE if sizes and every word match
+ */
+static Bool check_image(const MappedImage *mapped, const ObjectImage *image) {
+    long i;
+
+    if (mapped->code_size != image->code_size || mapped->data_size != image->data_size ||
+        mapped->checksum != image_checksum(image)) {
+        return FALSE;
+    }
+    for (i = 0; i < image->code_size; i++) {
+        if (mapped->code[i] != image->words[i]) return FALSE;
+    }
+    for (i = 0; i < image->data_size; i++) {
+        if (mapped->data[i] != image->words[image->code_size + i]) return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * main - Entry point of the image tool
+ *
+ * Returns:
+ * int: 0 if every image was built and verified, 1 otherwise
+ */
+int main(int argc, char *argv[]) {
+    MappedImage *mapped;
+    ObjectImage image;
+    int i, status = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s file1.ob [file2.ob ...]\n", argv[0]);
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++) {
+        if (!load_object_image(argv[i], &image)) {
+            fprintf(stderr, "Error: Cannot load object file %s\n", argv[i]);
+            status = 1;
+            continue;
+        }
+
+        mapped = load_cached_image(argv[i]);
+        if (!mapped) {
+            fprintf(stderr, "Error: Cannot create image of %s\n", argv[i]);
+            status = 1;
+        } else if (!check_image(mapped, &image)) {
+            fprintf(stderr, "Error: Image of %s does not match the object file\n", argv[i]);
+            status = 1;
+        } else {
+            printf("%s: %ld code words, %ld data words\n",
+                   argv[i], mapped->code_size, mapped->data_size);
+        }
+
+        unmap_image(mapped);
+        free_object_image(&image);
+    }
+
+    return status;
+}
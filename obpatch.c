@@ -0,0 +1,75 @@
+/*
+ * Delta Apply Tool
+ *
+ * Rebuilds a new object file from the previous one and a delta written
+ * by the assembler with the -d option:
+ *   obpatch old.ob file.obd new.ob
+ *
+ * Both checksums in the delta are verified: the old one before patching
+ * (the delta was made against this image) and the new one after.
+ * If the delta carries a new entry table it is written next to new.ob
+ * with the .ent extension, or that file is removed if the new table is
+ * empty (the assembler writes no .ent file without entries).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delta.h"
+
+/*
+ * main - Entry point of the delta apply tool
+ *
+ * Returns:
+ * int: 0 if the new image was written, 1 on error
+ */
+int main(int argc, char *argv[]) {
+    ObjectImage old_image, new_image;
+    char *entries;
+    char ent_filename[256];
+    size_t len;
+    int status = 0;
+
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s old.ob file.obd new.ob\n", argv[0]);
+        return 1;
+    }
+
+    /* A missing old image is empty - deltas against nothing hold every word */
+    load_object_image(argv[1], &old_image);
+
+    if (!apply_delta_file(argv[2], &old_image, &new_image, &entries)) {
+        free_object_image(&old_image);
+        return 1;
+    }
+
+    if (!write_object_image(argv[3], &new_image)) {
+        fprintf(stderr, "Error: Cannot create file %s\n", argv[3]);
+        status = 1;
+    }
+
+    /* Write the new entry table if it changed */
+    if (status == 0 && entries) {
+        FILE *fp;
+
+        len = strlen(argv[3]);
+        if (len > 3 && strcmp(argv[3] + len - 3, ".ob") == 0) len -= 3;
+        if (len > sizeof(ent_filename) - 5) len = sizeof(ent_filename) - 5;
+        memcpy(ent_filename, argv[3], len);
+        strcpy(ent_filename + len, ".ent");
+
+        if (!entries[0]) {
+            remove(ent_filename);
+        } else if (!(fp = fopen(ent_filename, "w"))) {
+            fprintf(stderr, "Error: Cannot create file %s\n", ent_filename);
+            status = 1;
+        } else {
+            fputs(entries, fp);
+            fclose(fp);
+        }
+    }
+
+    free(entries);
+    free_object_image(&old_image);
+    free_object_image(&new_image);
+    return status;
+}
@@ -7,6 +7,10 @@
  * 3. Handles relative addressing
  * 4. Generates final machine code with proper ARE bits
  *
+ * With -fpic, jumps to code labels of the same file are encoded in the
+ * relative form even when written as direct operands, so they need no
+ * relocation when the module is loaded at another address.
+ *
  * During this pass, all symbols must be defined (from first pass)
  * and their addresses are used to complete the machine code.
  */
@@ -19,6 +23,11 @@
 #include "utils.h"
 #include "instructions.h"
 #include "symbol_table.h"
+#include "xref.h"
+#include "lexer.h"
+
+/* Direct jumps turned into relative ones by -fpic */
+static long pic_count = 0;
 
 /*
  * process_line_second_pass - Processes a single line during second pass
@@ -38,83 +47,71 @@
  * 3. Updates machine code with proper symbol addresses
  */
 Bool process_line_second_pass(SourceLine line, long *ic, MachineWord **code, SymbolTable *symbols) {
-    int index = 0;
+    int index;
     char label[MAX_SOURCE_LINE];
     SymbolEntry *entry;
+    LineTokens tokens;
+    Directive dir;
     
-    /* Skip whitespace and comments */
-    skip_whitespace(line.text, &index);
-    if (!line.text[index] || line.text[index] == ';' || line.text[index] == '\n') 
+    /* Skip empty lines and comments */
+    scan_line(line.text, &tokens);
+    if (tokens.is_empty) 
         return TRUE;
     
-    /* Skip label if exists */
-    if (str_chr(line.text, ':')) {
-        while (line.text[index] && line.text[index] != ':') index++;
-        index++;
-    }
+    dir = get_instruction_type(line, &tokens, &index);
     
-    skip_whitespace(line.text, &index);
+    /* A global label on a code, .data or .string line starts the local
+     * scope of the lines after it, as in the first pass (add_label) */
+    if (tokens.has_label && (dir == DIR_NONE || dir == DIR_DATA || dir == DIR_STRING)) {
+        copy_token(line.text, tokens.label, label);
+        if (label[0] != '.') enter_scope(symbols, label);
+    }
     
-    /* Handle .entry directive */
-    if (line.text[index] == '.') {
-        /* Check for .entry */
-        if (strncmp(line.text + index, ".entry", 6) == 0) {
-            index += 6;
-            skip_whitespace(line.text, &index);
-            
-            /* Get label name */
-            if (!line.text[index]) {
-                print_error(line, "Missing label name for .entry directive");
-                return FALSE;
-            }
-            
-            /* Extract label name */
-            {
-                int i;
-                for (i = 0; line.text[index] && !strchr(" \t\n", line.text[index]); i++, index++) {
-                    if (i >= MAX_SOURCE_LINE - 1) {
-                        print_error(line, "Label name too long");
-                        return FALSE;
-                    }
-                    label[i] = line.text[index];
-                }
-                label[i] = '\0';
-            }
-            
-            /* Remove & if relative addressing */
-            if (label[0] == '&') {
-                int i;
-                for (i = 0; label[i + 1]; i++) {
-                    label[i] = label[i + 1];
-                }
-                label[i] = '\0';
+    /* Directives - only .entry has work left in the second pass */
+    if (dir != DIR_NONE) {
+        if (dir != DIR_ENTRY) return dir != DIR_ERROR;
+        
+        /* Get label name */
+        if (tokens.operand_count == 0) {
+            print_error(line, "Missing label name for .entry directive");
+            return FALSE;
+        }
+        copy_token(line.text, tokens.operands[0], label);
+        
+        /* Remove & if relative addressing */
+        if (label[0] == '&') {
+            int i;
+            for (i = 0; label[i + 1]; i++) {
+                label[i] = label[i + 1];
             }
+            label[i] = '\0';
+        }
+        
+        /* Check if already marked as entry */
+        if (!find_symbol_by_type(symbols, label, SYMBOL_ENTRY)) {
+            /* Look for symbol definition */
+            entry = find_symbol_by_type(symbols, label, SYMBOL_CODE);
+            if (!entry) entry = find_symbol_by_type(symbols, label, SYMBOL_DATA);
             
-            /* Check if already marked as entry */
-            if (!find_symbol_by_type(symbols, label, SYMBOL_ENTRY)) {
-                /* Look for symbol definition */
-                entry = find_symbol_by_type(symbols, label, SYMBOL_CODE);
-                if (!entry) entry = find_symbol_by_type(symbols, label, SYMBOL_DATA);
-                
-                if (!entry) {
-                    /* Check if external */
-                    if (find_symbol_by_type(symbols, label, SYMBOL_EXTERN)) {
-                        print_error(line, "Symbol %s cannot be both external and entry", label);
-                        return FALSE;
-                    }
-                    print_error(line, "Undefined symbol %s for .entry", label);
+            if (!entry) {
+                /* Check if external */
+                if (find_symbol_by_type(symbols, label, SYMBOL_EXTERN)) {
+                    print_error(line, "Symbol %s cannot be both external and entry", label);
                     return FALSE;
                 }
-                
-                /* Mark symbol as entry */
-                entry->type = SYMBOL_ENTRY;
+                print_error(line, "Undefined symbol %s for .entry", label);
+                return FALSE;
             }
+            
+            /* Mark symbol as entry */
+            entry->type = SYMBOL_ENTRY;
         }
+        xref_add(XREF_ENTRY, label, line.num, 0);
         return TRUE;
     }
     
     /* Handle code line symbols */
-    return resolve_symbols(line, ic, code, symbols);
+    return resolve_symbols(line, &tokens, ic, code, symbols);
 }
 
 /*
@@ -122,34 +119,18 @@ Bool process_line_second_pass(SourceLine line, long *ic, MachineWord **code, Sym
  *
  * Parameters:
  * line: Source line containing the instruction
+ * tokens: Tokens of the line from scan_line
  *
  * Returns:
  * OpCode: Operation code for the instruction
- *
- * Skips labels and whitespace to find operation name
  */
-static OpCode get_opcode_from_line(SourceLine line) {
-    int index = 0;
-    char op[MAX_OP_LEN + 1];
-    int i;
+static OpCode get_opcode_from_line(SourceLine line, const LineTokens *tokens) {
+    char op[MAX_SOURCE_LINE];
     OpCode opcode;
     FuncCode func;
     
-    /* Skip label if exists */
-    if (str_chr(line.text, ':')) {
-        while (line.text[index] && line.text[index] != ':') index++;
-        index++;
-    }
-    
-    skip_whitespace(line.text, &index);
-    
     /* Get operation name */
-    for (i = 0; i < MAX_OP_LEN && line.text[index] && 
-        line.text[index] != ' ' && line.text[index] != '\t' && 
-        line.text[index] != '\n'; i++, index++) {
-        op[i] = line.text[index];
-    }
-    op[i] = '\0';
+    copy_token(line.text, tokens->keyword, op);
     
     /* Get operation details */
     get_operation_details(op, &opcode, &func);
@@ -161,6 +142,7 @@ static OpCode get_opcode_from_line(SourceLine line) {
  *
  * Parameters:
  * line: Source line with instruction
+ * tokens: Tokens of the line from scan_line
  * ic: Pointer to instruction counter
  * code: Array of machine code words
  * symbols: Symbol table with all defined symbols
@@ -173,10 +155,10 @@ static OpCode get_opcode_from_line(SourceLine line) {
  * 2. Resolves symbol addresses
  * 3. Updates machine code with proper symbol values and ARE bits
  */
-Bool resolve_symbols(SourceLine line, long *ic, MachineWord **code, SymbolTable *symbols) {
-    char label[MAX_SOURCE_LINE];
-    char *operands[2];
-    int index = 0, op_count;
+Bool resolve_symbols(SourceLine line, const LineTokens *tokens, long *ic,
+                     MachineWord **code, SymbolTable *symbols) {
+    char operands[2][MAX_SOURCE_LINE];
+    int op_count;
     Bool success = TRUE;
     long curr_ic = *ic;
     int inst_len;
@@ -187,34 +169,22 @@ Bool resolve_symbols(SourceLine line, long *ic, MachineWord **code, SymbolTable
     
     /* Don't skip operations with length 1 - they may still have operands that need symbol resolution */
     
-    /* Skip label if exists */
-    if (get_label(line, label)) {
-        while (line.text[index] != ':') index++;
-        index++;
-    }
-    
-    skip_whitespace(line.text, &index);
-    
     /* Get opcode for later validation */
-    opcode = get_opcode_from_line(line);
-    
-    /* Skip operation name */
-    while (line.text[index] && !strchr(" \t\n", line.text[index])) index++;
-    skip_whitespace(line.text, &index);
+    opcode = get_opcode_from_line(line, tokens);
     
     /* Parse operands */
-    if (!parse_operands(line, index, operands, &op_count, "")) {
+    if (!parse_operands(line, tokens, operands, &op_count, "")) {
         return FALSE;
     }
     
     /* Process operands */
     if (op_count > 0) {
-        success = process_operand_second_pass(line, &curr_ic, ic, operands[0], code, symbols, opcode);
-        free(operands[0]);
+        success = process_operand_second_pass(line, &curr_ic, ic, operands[0], tokens->operand_kinds[0],
+                                              code, symbols, opcode);
         
         if (success && op_count > 1) {
-            success = process_operand_second_pass(line, &curr_ic, ic, operands[1], code, symbols, opcode);
-            free(operands[1]);
+            success = process_operand_second_pass(line, &curr_ic, ic, operands[1], tokens->operand_kinds[1],
+                                                  code, symbols, opcode);
         }
     }
     
@@ -231,6 +201,7 @@ Bool resolve_symbols(SourceLine line, long *ic, MachineWord **code, SymbolTable
  * curr_ic: Pointer to current instruction counter
  * start_ic: Pointer to instruction start address
  * operand: Operand string to process
+ * kind: Operand kind found by the lexer
  * code: Array of machine code words
  * symbols: Symbol table with all defined symbols
  * opcode: Operation code for validation
@@ -238,6 +209,9 @@ Bool resolve_symbols(SourceLine line, long *ic, MachineWord **code, SymbolTable
  * Returns:
  * Bool: TRUE if operand processed successfully, FALSE if error
  *
+ * The first pass has already validated the operand, so finding its
+ * addressing mode reports nothing here.
+ *
  * This function:
  * 1. Handles direct and relative addressing modes
  * 2. Resolves symbol addresses
@@ -246,14 +220,20 @@ Bool resolve_symbols(SourceLine line, long *ic, MachineWord **code, SymbolTable
  * 5. Creates additional entries for external references
  */
 Bool process_operand_second_pass(SourceLine line, long *curr_ic, long *start_ic, 
-                               char *operand, MachineWord **code, SymbolTable *symbols,
-                               OpCode opcode) {
-    AddressMode mode = get_addressing_mode(operand);
+                               const char *operand, OperandKind kind, MachineWord **code,
+                               SymbolTable *symbols, OpCode opcode) {
+    AddressMode mode = get_addressing_mode(line, operand, kind);
     MachineWord *word;
     
     /* Skip immediate addressing (already handled) and registers */
     if (mode == IMMEDIATE || mode == REGISTER_MODE) {
-        if (mode == IMMEDIATE) (*curr_ic)++;
+        if (mode == IMMEDIATE) {
+            /* Record uses of .equ constants for the cross-reference index */
+            if (is_valid_label(operand + 1)) {
+                xref_add(XREF_REF, operand + 1, line.num, (*curr_ic) + 1);
+            }
+            (*curr_ic)++;
+        }
         return TRUE;
     }
     
@@ -261,25 +241,43 @@ Bool process_operand_second_pass(SourceLine line, long *curr_ic, long *start_ic,
     if (mode == DIRECT || mode == RELATIVE) {
         long value;
         SymbolEntry *symbol;
-        char *sym_name = operand;
+        const char *sym_name = operand;
         unsigned int are_value;
         
         /* Remove & for relative addressing */
         if (mode == RELATIVE) sym_name++;
         
-        /* Look for symbol */
-        symbol = find_symbol(symbols, sym_name);
+        /* Look for symbol (local labels only in the current scope) */
+        if (sym_name[0] == '.') {
+            symbol = find_local_symbol(symbols, sym_name);
+        } else {
+            symbol = find_symbol(symbols, sym_name);
+            xref_add(XREF_REF, sym_name, line.num, (*curr_ic) + 1);
+        }
         if (!symbol) {
             print_error(line, "Undefined symbol: %s", sym_name);
             return FALSE;
         }
         
+        /* Constants have no address - they are only usable as immediates */
+        if (symbol->type == SYMBOL_CONST) {
+            print_error(line, "Constant %s cannot be used as an address, use #%s", sym_name, sym_name);
+            return FALSE;
+        }
+        
         /* Validate relative addressing usage with jump instructions */
         if (mode == RELATIVE && opcode != OP_JUMPS) {
             print_error(line, "Relative addressing mode (&) can only be used with jump instructions (jmp, bne, jsr)");
             return FALSE;
         }
         
+        /* Position-independent mode: local jump targets become relative */
+        if (options.pic && mode == DIRECT && opcode == OP_JUMPS && is_code_symbol(symbols, symbol)) {
+            code[(*start_ic) - START_IC]->content.code->dest_mode = RELATIVE;
+            mode = RELATIVE;
+            pic_count++;
+        }
+        
         /* Calculate value based on addressing mode */
         if (mode == DIRECT) {
             /* Direct addressing - use the symbol's address */
@@ -293,7 +291,7 @@ Bool process_operand_second_pass(SourceLine line, long *curr_ic, long *start_ic,
             }
         } else { /* RELATIVE */
             /* Relative addressing - calculate distance between current instruction and target */
-            if (symbol->type != SYMBOL_CODE) {
+            if (!is_code_symbol(symbols, symbol)) {
                 print_error(line, "Symbol %s must be a code label for relative addressing", sym_name);
                 return FALSE;
             }
@@ -336,3 +334,17 @@ Bool process_operand_second_pass(SourceLine line, long *curr_ic, long *start_ic,
     
     return TRUE;
 }
+
+/*
+ * take_pic_count - Returns the number of relocations removed by -fpic
+ *
+ * Returns:
+ * long: Direct jumps encoded as relative since the last call
+ *
+ * Resets the count, so each file reports only its own jumps.
+ */
+long take_pic_count(void) {
+    long count = pic_count;
+    pic_count = 0;
+    return count;
+}
@@ -4,6 +4,7 @@
 
 #include "globals.h"
 #include "symbol_table.h"
+#include "lexer.h"
 
 /* Process a single line in second pass */
 Bool process_line_second_pass(
@@ -16,6 +17,7 @@ Bool process_line_second_pass(
 /* Add symbols to code words */
 Bool resolve_symbols(
     SourceLine line,      /* Current line */
+    const LineTokens *tokens, /* Tokens of the line */
     long *ic,            /* Instruction counter */
     MachineWord **code,  /* Code image */
     SymbolTable *symbols /* Symbol table */
@@ -26,10 +28,14 @@ Bool process_operand_second_pass(
     SourceLine line,      /* Current line */
     long *curr_ic,       /* Current instruction position */
     long *start_ic,      /* Start of instruction */
-    char *operand,       /* Operand to process */
+    const char *operand, /* Operand to process */
+    OperandKind kind,    /* Operand kind from the lexer */
     MachineWord **code,  /* Code image */
     SymbolTable *symbols, /* Symbol table */
     OpCode opcode        /* Operation code for validation */
 );
 
+/* Number of relocations removed by -fpic since the last call (resets it) */
+long take_pic_count(void);
+
 #endif /* SECOND_PASS_H */
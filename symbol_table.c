@@ -9,6 +9,11 @@
  *
  * The symbol table is implemented as a linked list for simplicity
  * and flexibility in adding new symbols during assembly.
+ *
+ * Local labels (names starting with '.') live in small per-scope tables
+ * instead of the global list. Each global label opens a scope; the
+ * second pass releases a scope as soon as it moves past it, since all
+ * references inside it have been resolved by then.
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +34,10 @@ SymbolTable* create_symbol_table(void) {
     SymbolTable* table = (SymbolTable*)safe_malloc(sizeof(SymbolTable));
     table->first = NULL;
     table->last = NULL;
+    table->scopes = NULL;
+    table->last_scope = NULL;
+    table->current_scope = NULL;
+    table->code_end = 0;
     
     return table;
 }
@@ -155,6 +164,176 @@ Bool update_symbol_address(SymbolTable *table, const char *name, long new_addr)
     return TRUE;
 }
 
+/*
+ * relocate_data_symbols - Moves data symbols after the code section
+ *
+ * Parameters:
+ * table: Symbol table to update
+ * offset: Final instruction counter (start of the data section)
+ *
+ * Updates global data labels and the data labels of every local scope,
+ * and records the offset as the end of the code section.
+ */
+void relocate_data_symbols(SymbolTable *table, long offset) {
+    SymbolEntry *entry;
+    LocalScope *scope;
+    
+    table->code_end = offset;
+    
+    for (entry = table->first; entry; entry = entry->next) {
+        if (entry->type == SYMBOL_DATA) {
+            entry->address += offset;
+        }
+    }
+    
+    for (scope = table->scopes; scope; scope = scope->next) {
+        if (scope->locals) {
+            relocate_data_symbols(scope->locals, offset);
+        }
+    }
+}
+
+/*
+ * is_code_symbol - Checks if a symbol is a code label of this file
+ *
+ * Parameters:
+ * table: Symbol table the symbol belongs to
+ * symbol: Symbol to check
+ *
+ * Returns:
+ * Bool: TRUE for code labels, including code labels marked by .entry
+ *
+ * .entry replaces a label's type, so entry labels are told apart by
+ * section: code addresses lie below the end of the code section.
+ */
+Bool is_code_symbol(SymbolTable *table, SymbolEntry *symbol) {
+    if (symbol->type == SYMBOL_CODE) return TRUE;
+    return symbol->type == SYMBOL_ENTRY && symbol->address < table->code_end;
+}
+
+/*
+ * append_scope - Adds a new scope at the end of the scope list
+ */
+static LocalScope* append_scope(SymbolTable *table, const char *owner) {
+    LocalScope *scope = (LocalScope*)safe_malloc(sizeof(LocalScope));
+    
+    scope->owner = owner ? str_copy(owner) : NULL;
+    scope->locals = NULL;
+    scope->next = NULL;
+    
+    if (!table->scopes) {
+        table->scopes = scope;
+    } else {
+        table->last_scope->next = scope;
+    }
+    table->last_scope = scope;
+    
+    return scope;
+}
+
+/*
+ * free_scope - Deallocates a scope and its local labels
+ */
+static void free_scope(LocalScope *scope) {
+    free_symbol_table(scope->locals);
+    free(scope->owner);
+    free(scope);
+}
+
+/*
+ * open_scope - Starts the local scope of a global label
+ *
+ * Parameters:
+ * table: Symbol table
+ * owner: Name of the global label
+ *
+ * Called by the first pass for every global label definition.
+ */
+void open_scope(SymbolTable *table, const char *owner) {
+    table->current_scope = append_scope(table, owner);
+}
+
+/*
+ * add_local_symbol - Adds a local label to the current scope
+ *
+ * Parameters:
+ * table: Symbol table
+ * name: Local label name (including the leading '.')
+ * addr: Memory address of the label
+ * type: SYMBOL_CODE or SYMBOL_DATA
+ *
+ * Returns:
+ * Bool: TRUE if added, FALSE if already defined in this scope
+ *
+ * Locals before the first global label get a scope without an owner.
+ */
+Bool add_local_symbol(SymbolTable *table, const char *name, long addr, SymbolType type) {
+    LocalScope *scope;
+    
+    if (!table->current_scope) {
+        table->current_scope = append_scope(table, NULL);
+    }
+    
+    scope = table->current_scope;
+    if (!scope->locals) {
+        scope->locals = create_symbol_table();
+    }
+    
+    return add_symbol(scope->locals, name, addr, type);
+}
+
+/*
+ * find_local_symbol - Searches the current scope for a local label
+ *
+ * Parameters:
+ * table: Symbol table
+ * name: Local label name (including the leading '.')
+ *
+ * Returns:
+ * SymbolEntry*: Found entry, NULL if not defined in the current scope
+ */
+SymbolEntry* find_local_symbol(SymbolTable *table, const char *name) {
+    if (!table || !table->current_scope) return NULL;
+    
+    return find_symbol(table->current_scope->locals, name);
+}
+
+/*
+ * rewind_scopes - Positions the scope list for the second pass
+ *
+ * Parameters:
+ * table: Symbol table
+ *
+ * The second pass starts in the scope without an owner, if locals were
+ * defined before the first global label, and outside any scope otherwise.
+ */
+void rewind_scopes(SymbolTable *table) {
+    table->current_scope = (table->scopes && !table->scopes->owner) ? table->scopes : NULL;
+}
+
+/*
+ * enter_scope - Moves the second pass into the scope of a global label
+ *
+ * Parameters:
+ * table: Symbol table
+ * owner: Global label defined on the current line
+ *
+ * Scopes before the new one are released - their references have all
+ * been resolved, so their local tables are no longer needed.
+ */
+void enter_scope(SymbolTable *table, const char *owner) {
+    LocalScope *next = table->current_scope ? table->current_scope->next : table->scopes;
+    
+    if (!next || !next->owner || str_cmp(next->owner, owner) != 0) return;
+    
+    while (table->scopes != next) {
+        LocalScope *done = table->scopes;
+        table->scopes = done->next;
+        free_scope(done);
+    }
+    table->current_scope = next;
+}
+
 /*
  * free_symbol_table - Deallocates all memory used by symbol table
  *
@@ -178,5 +357,12 @@ void free_symbol_table(SymbolTable *table) {
         current = next;
     }
     
+    /* Free scopes not released by the second pass */
+    while (table->scopes) {
+        LocalScope *scope = table->scopes;
+        table->scopes = scope->next;
+        free_scope(scope);
+    }
+    
     free(table);
 }
@@ -9,7 +9,8 @@ typedef enum {
     SYMBOL_CODE,     /* Label for code section */
     SYMBOL_DATA,     /* Label for data section */
     SYMBOL_ENTRY,    /* Entry label */
-    SYMBOL_EXTERN    /* External label */
+    SYMBOL_EXTERN,   /* External label */
+    SYMBOL_CONST     /* Assemble-time constant (.equ), address holds the value */
 } SymbolType;
 
 /* Symbol table entry */
@@ -20,10 +21,21 @@ typedef struct symbol_entry {
     struct symbol_entry *next; /* Next in linked list */
 } SymbolEntry;
 
+/* Local label scope - the lines from one global label to the next */
+typedef struct local_scope {
+    char *owner;                    /* Global label opening the scope (NULL before the first) */
+    struct symbol_table *locals;    /* Local labels (created on first use) */
+    struct local_scope *next;       /* Next scope in source order */
+} LocalScope;
+
 /* Symbol table */
 typedef struct symbol_table {
     SymbolEntry *first;
     SymbolEntry *last;
+    LocalScope *scopes;             /* Oldest scope not yet released */
+    LocalScope *last_scope;         /* Newest scope */
+    LocalScope *current_scope;      /* Scope of the line being processed */
+    long code_end;                  /* First address after the code section (set with data relocation) */
 } SymbolTable;
 
 /* Create new symbol table */
@@ -41,6 +53,27 @@ SymbolEntry* find_symbol_by_type(SymbolTable *table, const char *name, SymbolTyp
 /* Update symbol address */
 Bool update_symbol_address(SymbolTable *table, const char *name, long new_addr);
 
+/* Add data section offset to all data symbol addresses, including locals */
+void relocate_data_symbols(SymbolTable *table, long offset);
+
+/* Check if a symbol labels code in this file (also after .entry marked it) */
+Bool is_code_symbol(SymbolTable *table, SymbolEntry *symbol);
+
+/* Open a new local scope for a global label (first pass) */
+void open_scope(SymbolTable *table, const char *owner);
+
+/* Add local label to the current scope */
+Bool add_local_symbol(SymbolTable *table, const char *name, long addr, SymbolType type);
+
+/* Find local label in the current scope */
+SymbolEntry* find_local_symbol(SymbolTable *table, const char *name);
+
+/* Go back to the first scope before the second pass */
+void rewind_scopes(SymbolTable *table);
+
+/* Enter the scope of a global label, releasing the scopes before it (second pass) */
+void enter_scope(SymbolTable *table, const char *owner);
+
 /* Free symbol table memory */
 void free_symbol_table(SymbolTable *table);
 
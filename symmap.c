@@ -0,0 +1,342 @@
+/*
+ * Address-to-Symbol Map Implementation
+ *
+ * This module writes a binary map from addresses to labels so profilers,
+ * crash decoders and trace tools can name raw addresses without
+ * re-running the assembler:
+ * 1. Code and data labels, including local labels, are collected once
+ *    their final addresses are known (before the second pass releases
+ *    the local scopes)
+ * 2. The labels are sorted by address, sized, and written to <file>.sym
+ * 3. Tools map the file read-only and find the nearest label at or
+ *    before an address by binary search, without parsing or copying
+ *
+ * File Format (all numbers 32-bit little-endian):
+ * - Header (16 bytes): "SYM1", entry count, string table size, 0
+ * - Entries (16 bytes each, sorted by address):
+ *   address, size in words, name offset, section ('C'/'D') and 3 zero bytes
+ * - String table: null-terminated names
+ *
+ * Local labels are named after their scope, as OWNER.local, so a name
+ * is meaningful without the source file.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "symmap.h"
+#include "utils.h"
+
+#define SYMMAP_MAGIC "SYM1"
+#define HEADER_SIZE 16
+#define ENTRY_SIZE 16
+
+/* Label collected for the map */
+typedef struct {
+    char *name;
+    long address;
+    long size;
+    char section;
+} MapEntry;
+
+/* Labels collected for the file being assembled */
+static MapEntry *collected = NULL;
+static long collected_count = 0;
+static long collected_cap = 0;
+
+/*
+ * add_entry - Appends a label to the collected map entries
+ *
+ * Parameters:
+ * owner: Global label of the local scope, NULL for global labels
+ * name: Label name
+ * address: Final label address
+ * code_end: First address after the code section
+ */
+static void add_entry(const char *owner, const char *name, long address, long code_end) {
+    MapEntry *entry;
+
+    if (collected_count == collected_cap) {
+        collected_cap = collected_cap ? collected_cap * 2 : 64;
+        collected = (MapEntry*)safe_realloc(collected, collected_cap * sizeof(MapEntry));
+    }
+
+    entry = &collected[collected_count++];
+    if (owner) {
+        entry->name = (char*)safe_malloc(strlen(owner) + strlen(name) + 1);
+        sprintf(entry->name, "%s%s", owner, name);
+    } else {
+        entry->name = str_copy(name);
+    }
+    entry->address = address;
+    entry->size = 0;
+    entry->section = address < code_end ? SYMMAP_CODE : SYMMAP_DATA;
+}
+
+/*
+ * add_labels - Adds the code and data labels of one symbol table
+ *
+ * Entry labels are included too - their section follows from their
+ * address. Externals and constants have no address in this file.
+ */
+static void add_labels(SymbolTable *table, const char *owner, long code_end) {
+    SymbolEntry *symbol;
+
+    if (!table) return;
+
+    for (symbol = table->first; symbol; symbol = symbol->next) {
+        if (symbol->type == SYMBOL_CODE || symbol->type == SYMBOL_DATA ||
+            symbol->type == SYMBOL_ENTRY) {
+            add_entry(owner, symbol->name, symbol->address, code_end);
+        }
+    }
+}
+
+/*
+ * compare_entries - qsort comparator ordering entries by address, then name
+ */
+static int compare_entries(const void *a, const void *b) {
+    const MapEntry *ea = (const MapEntry*)a;
+    const MapEntry *eb = (const MapEntry*)b;
+
+    if (ea->address != eb->address) return ea->address < eb->address ? -1 : 1;
+    return strcmp(ea->name, eb->name);
+}
+
+/*
+ * symmap_collect - Collects every label with its final address
+ *
+ * Parameters:
+ * symbols: Symbol table after data symbols were relocated
+ * code_end: First address after the code section (final IC)
+ * data_end: First address after the data section
+ *
+ * Must run before the second pass, which releases local scopes as it
+ * goes. Each label's size is the number of words up to the next label
+ * of its section, or to the end of the section.
+ */
+void symmap_collect(SymbolTable *symbols, long code_end, long data_end) {
+    LocalScope *scope;
+    long i, next_address = 0;
+    char next_section = 0;
+
+    symmap_end();
+
+    add_labels(symbols, NULL, code_end);
+    for (scope = symbols->scopes; scope; scope = scope->next) {
+        add_labels(scope->locals, scope->owner ? scope->owner : "", code_end);
+    }
+
+    qsort(collected, collected_count, sizeof(MapEntry), compare_entries);
+
+    /* Walk backwards so each entry sees the next higher address */
+    for (i = collected_count - 1; i >= 0; i--) {
+        MapEntry *entry = &collected[i];
+
+        if (entry->section != next_section) {
+            next_section = entry->section;
+            next_address = entry->section == SYMMAP_CODE ? code_end : data_end;
+        }
+        entry->size = next_address - entry->address;
+        if (i == 0 || collected[i - 1].address != entry->address) {
+            next_address = entry->address;
+        }
+    }
+}
+
+/*
+ * put_u32 - Writes a 32-bit little-endian number
+ */
+static void put_u32(FILE *fp, unsigned long value) {
+    fputc((int)(value & 0xFF), fp);
+    fputc((int)((value >> 8) & 0xFF), fp);
+    fputc((int)((value >> 16) & 0xFF), fp);
+    fputc((int)((value >> 24) & 0xFF), fp);
+}
+
+/*
+ * symmap_write - Writes the collected labels to the map file (.sym)
+ *
+ * Parameters:
+ * base_name: Base name for the output file
+ *
+ * Returns:
+ * Bool: TRUE if file written successfully, FALSE if error
+ */
+Bool symmap_write(const char *base_name) {
+    char filename[256];
+    FILE *fp;
+    unsigned long strings_size = 0;
+    long i;
+    Bool ok;
+
+    sprintf(filename, "%s.sym", base_name);
+
+    fp = fopen(filename, "wb");
+    if (!fp) return FALSE;
+
+    for (i = 0; i < collected_count; i++) {
+        strings_size += strlen(collected[i].name) + 1;
+    }
+
+    /* Header */
+    fwrite(SYMMAP_MAGIC, 1, 4, fp);
+    put_u32(fp, (unsigned long)collected_count);
+    put_u32(fp, strings_size);
+    put_u32(fp, 0);
+
+    /* Entries, names are laid out in entry order */
+    strings_size = 0;
+    for (i = 0; i < collected_count; i++) {
+        put_u32(fp, (unsigned long)collected[i].address);
+        put_u32(fp, (unsigned long)collected[i].size);
+        put_u32(fp, strings_size);
+        put_u32(fp, (unsigned long)(unsigned char)collected[i].section);
+        strings_size += strlen(collected[i].name) + 1;
+    }
+
+    /* String table */
+    for (i = 0; i < collected_count; i++) {
+        fwrite(collected[i].name, 1, strlen(collected[i].name) + 1, fp);
+    }
+
+    ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
+
+/*
+ * symmap_end - Frees the collected labels
+ */
+void symmap_end(void) {
+    long i;
+
+    for (i = 0; i < collected_count; i++) {
+        free(collected[i].name);
+    }
+    free(collected);
+
+    collected = NULL;
+    collected_count = 0;
+    collected_cap = 0;
+}
+
+/*
+ * get_u32 - Reads a 32-bit little-endian number
+ */
+static unsigned long get_u32(const unsigned char *p) {
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/*
+ * symmap_open - Maps a map file written by symmap_write
+ *
+ * Parameters:
+ * filename: Path of the .sym file
+ *
+ * Returns:
+ * SymbolMap*: Mapped file, NULL if the file is missing or malformed
+ *
+ * The file is mapped read-only and shared, so every tool process
+ * looking at the same program uses the same pages.
+ */
+SymbolMap* symmap_open(const char *filename) {
+    SymbolMap *map;
+    struct stat st;
+    void *base;
+    const unsigned char *bytes;
+    unsigned long count, strings_size;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    bytes = (const unsigned char*)base;
+    count = get_u32(bytes + 4);
+    strings_size = get_u32(bytes + 8);
+
+    /* Sizes must add up and the last name must be terminated */
+    if (memcmp(bytes, SYMMAP_MAGIC, 4) != 0 ||
+        (unsigned long)st.st_size != HEADER_SIZE + count * ENTRY_SIZE + strings_size ||
+        (strings_size && bytes[st.st_size - 1] != '\0')) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+
+    map = (SymbolMap*)safe_malloc(sizeof(SymbolMap));
+    map->base = bytes;
+    map->length = (size_t)st.st_size;
+    map->count = count;
+    map->entries = bytes + HEADER_SIZE;
+    map->strings = (const char*)(map->entries + count * ENTRY_SIZE);
+    return map;
+}
+
+/*
+ * symmap_find - Finds the label an address belongs to
+ *
+ * Parameters:
+ * map: Mapped file
+ * address: Address to look up
+ * info: Output: the label with the highest address not above it
+ *
+ * Returns:
+ * Bool: TRUE if found, FALSE if the address is below every label
+ *
+ * Callers can compare address - info->address with info->size to tell
+ * whether the address is inside the label's words.
+ */
+Bool symmap_find(const SymbolMap *map, unsigned long address, SymbolInfo *info) {
+    unsigned long lo = 0, hi, name_offset;
+    const unsigned char *entry;
+
+    if (!map) return FALSE;
+
+    /* First entry above the address, the answer is the one before it */
+    hi = map->count;
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2;
+
+        if (get_u32(map->entries + mid * ENTRY_SIZE) <= address)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0) return FALSE;
+
+    entry = map->entries + (lo - 1) * ENTRY_SIZE;
+    name_offset = get_u32(entry + 8);
+    if (name_offset >= (unsigned long)(map->base + map->length - (const unsigned char*)map->strings)) {
+        return FALSE;
+    }
+
+    info->name = map->strings + name_offset;
+    info->address = get_u32(entry);
+    info->size = get_u32(entry + 4);
+    info->section = (char)entry[12];
+    return TRUE;
+}
+
+/*
+ * symmap_close - Unmaps a map file and frees its handle
+ */
+void symmap_close(SymbolMap *map) {
+    if (!map) return;
+
+    munmap((void*)map->base, map->length);
+    free(map);
+}
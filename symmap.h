@@ -0,0 +1,48 @@
+/* Address-to-symbol map for profilers, crash decoders and trace tools */
+#ifndef SYMMAP_H
+#define SYMMAP_H
+
+#include <stddef.h>
+#include "globals.h"
+#include "symbol_table.h"
+
+/* Section of a mapped symbol (single byte in the .sym file) */
+#define SYMMAP_CODE 'C'
+#define SYMMAP_DATA 'D'
+
+/* Symbol found by a lookup */
+typedef struct {
+    const char *name;        /* Label name (locals as OWNER.local) */
+    unsigned long address;   /* Label address */
+    unsigned long size;      /* Words up to the next label or section end */
+    char section;            /* SYMMAP_CODE or SYMMAP_DATA */
+} SymbolInfo;
+
+/* Memory-mapped .sym file */
+typedef struct {
+    const unsigned char *base;       /* Start of the mapping */
+    size_t length;                   /* Mapping length in bytes */
+    unsigned long count;             /* Number of entries */
+    const unsigned char *entries;    /* Entry array, sorted by address */
+    const char *strings;             /* Name string table */
+} SymbolMap;
+
+/* Collect code and data labels, including locals (after data relocation) */
+void symmap_collect(SymbolTable *symbols, long code_end, long data_end);
+
+/* Write collected labels to <base_name>.sym */
+Bool symmap_write(const char *base_name);
+
+/* Discard collected labels */
+void symmap_end(void);
+
+/* Map a .sym file read-only, returns NULL on error */
+SymbolMap* symmap_open(const char *filename);
+
+/* Find the nearest label at or before an address, FALSE if none */
+Bool symmap_find(const SymbolMap *map, unsigned long address, SymbolInfo *info);
+
+/* Unmap and free a map */
+void symmap_close(SymbolMap *map);
+
+#endif /* SYMMAP_H */
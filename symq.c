@@ -0,0 +1,55 @@
+/*
+ * Address-to-Symbol Query Tool
+ *
+ * Names raw addresses from a map written by the assembler with the -m
+ * option:
+ *   symq file.sym ADDRESS [ADDRESS ...]
+ *
+ * Output lines are: <address> <name>+<offset> <section> <size>
+ * Addresses below every label are printed with "?" as the name.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "symmap.h"
+
+/*
+ * main - Entry point of the query tool
+ *
+ * Returns:
+ * int: 0 if every address was named, 1 if some were not, 2 on usage error
+ */
+int main(int argc, char *argv[]) {
+    SymbolMap *map;
+    SymbolInfo info;
+    int i, status = 0;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s file.sym address [address ...]\n", argv[0]);
+        return 2;
+    }
+
+    map = symmap_open(argv[1]);
+    if (!map) {
+        fprintf(stderr, "Error: Cannot load map %s\n", argv[1]);
+        return 2;
+    }
+
+    for (i = 2; i < argc; i++) {
+        char *end;
+        unsigned long address = strtoul(argv[i], &end, 10);
+
+        if (*end != '\0') {
+            fprintf(stderr, "Error: Invalid address '%s'\n", argv[i]);
+            status = 2;
+        } else if (symmap_find(map, address, &info)) {
+            printf("%07lu %s+%lu %c %lu\n", address, info.name,
+                   address - info.address, info.section, info.size);
+        } else {
+            printf("%07lu ?\n", address);
+            if (status == 0) status = 1;
+        }
+    }
+
+    symmap_close(map);
+    return status;
+}
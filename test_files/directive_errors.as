@@ -0,0 +1,3 @@
+; Directive names must end at whitespace
+MAIN: stop
+NUMS: .data5
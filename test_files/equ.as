@@ -0,0 +1,11 @@
+; Assemble-time constants (.equ) used as immediate operands
+SIZE: .equ 8
+NEG: .equ -3
+.entry MAIN
+MAIN: mov #SIZE, r1
+ add #NEG, r1
+ cmp #SIZE, #5
+ prn #NEG
+ lea BUF, r2
+ stop
+BUF: .data 1, 2, 3
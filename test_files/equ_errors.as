@@ -0,0 +1,4 @@
+; A constant must be defined before it is used
+MAIN: mov #LIMIT, r1
+ stop
+LIMIT: .equ 3
@@ -0,0 +1,4 @@
+; A constant takes a single value
+LIMIT: .equ 3 4
+MAIN: mov #LIMIT, r1
+ stop
@@ -0,0 +1,5 @@
+; A local label is only visible in its own scope
+FIRST: dec r1
+.loop: bne .loop
+SECOND: jmp .loop
+ stop
@@ -0,0 +1,17 @@
+; Local labels (.name) are scoped to the global label before them
+.entry FIRST
+.entry SECOND
+FIRST: mov #3, r1
+.loop: dec r1
+ bne .loop
+ jmp .done
+.done: rts
+SECOND: mov #5, r2
+.loop: dec r2
+SIZE: .equ 2
+THIRD: .extern OTHER
+ bne &.loop
+ lea .buf, r3
+.done: stop
+.buf: .data 4, 5
+THIRD: clr r4
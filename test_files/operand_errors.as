@@ -0,0 +1,5 @@
+; Operands are reported with their line; a label may start with r
+MAIN: inc rows
+ mov r9, r1
+ stop
+rows: .data 3
@@ -0,0 +1,14 @@
+; -fpic: jumps to code labels of this file are encoded as relative,
+; whether .entry comes before or after the jump
+.extern EXT
+.entry SUB
+MAIN: jsr SUB
+ jmp LATE
+ bne MAIN
+ jsr EXT
+ lea MSG, r1
+ stop
+SUB: rts
+LATE: jmp SUB
+MSG: .string "hi"
+.entry LATE
@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+
+# Round trips through the helper tools (xrefq, obpatch, symq, obimage).
+# Run by "make test" after testrunner, from the directory holding the
+# tools, on the scratch copy of test_files it assembled:
+#   bash test_files/tools.sh test_out
+
+bin=$(pwd)
+cd "$1" || exit 1
+failed=0
+
+check() {
+  if [ "$2" = "$3" ]; then
+    echo "PASS $1"
+  else
+    echo "FAIL $1: expected '$3', got '$2'"
+    failed=1
+  fi
+}
+
+# xrefq answers from the index written by -x (options in xref.flags)
+"$bin/assembler" $(cat xref.flags) xref > /dev/null 2>&1
+check "xrefq def" "$("$bin/xrefq" xref.xrf def COUNT)" "COUNT D 10 0000110"
+check "xrefq complete" "$("$bin/xrefq" xref.xrf complete D)" "DONE"
+check "xrefq refs" "$("$bin/xrefq" xref.xrf refs PRINT | tr '\n' ' ')" \
+  "PRINT X 2 0000000 PRINT R 6 0000104 "
+
+# -d writes a delta that obpatch turns the previous build into the new one
+cp allvalid.as delta.as
+"$bin/assembler" delta > /dev/null 2>&1
+cp delta.ob delta.old.ob
+sed -i 's/^\(.*\)\.data \([0-9-]*\)/\1.data 99/' delta.as
+"$bin/assembler" -d delta > /dev/null 2>&1
+"$bin/obpatch" delta.old.ob delta.obd delta.patched.ob
+check "delta round trip" "$(cmp -s delta.patched.ob delta.ob && echo same)" "same"
+check "delta is smaller than the object file" \
+  "$([ "$(wc -l < delta.obd)" -lt "$(wc -l < delta.ob)" ] && echo yes)" "yes"
+
+# Dropping the last .entry sends an empty entry table, and both sides
+# remove the stale .ent file
+printf '.entry MAIN\nMAIN: inc r1\n stop\n' > noent.as
+"$bin/assembler" noent > /dev/null 2>&1
+cp noent.ob noent.old.ob
+cp noent.ent noent.patched.ent
+printf 'MAIN: inc r1\n stop\n' > noent.as
+"$bin/assembler" -d noent > /dev/null 2>&1
+check "delta clears the entry table" "$(grep '^N' noent.obd)" "N 0"
+check "assembler removes the stale .ent" "$([ -e noent.ent ] || echo removed)" "removed"
+"$bin/obpatch" noent.old.ob noent.obd noent.patched.ob
+check "obpatch removes the .ent" "$([ -e noent.patched.ent ] || echo removed)" "removed"
+
+# symq names addresses from the map written by -m, locals as OWNER.local
+check "symq code" "$("$bin/symq" xref.sym 105)" "0000105 MAIN.next+3 C 7"
+check "symq data" "$("$bin/symq" xref.sym 111)" "0000111 TEXT+0 D 3"
+check "symq below first label" "$("$bin/symq" xref.sym 99)" "0000099 ?"
+
+# obimage builds the mapped image cache and checks it against the .ob
+check "obimage" "$("$bin/obimage" delta.ob 2>&1)" \
+  "delta.ob: 100 code words, 132 data words"
+
+# A cached image is rebuilt after a same-size rewrite of its object file,
+# even within the same second: by obpatch and by an in-place copy
+cp delta.old.ob image.ob
+"$bin/obimage" image.ob > /dev/null
+"$bin/obpatch" image.ob delta.obd image.ob
+check "obimage after same-size patch" "$("$bin/obimage" image.ob 2>&1)" \
+  "image.ob: 100 code words, 132 data words"
+cat delta.old.ob > image.ob
+check "obimage after same-size rewrite in place" "$("$bin/obimage" image.ob 2>&1)" \
+  "image.ob: 100 code words, 132 data words"
+
+exit $failed
@@ -0,0 +1,11 @@
+; -x and -m: cross-reference index and address-to-symbol map
+.extern PRINT
+.entry MAIN
+MAIN: mov COUNT, r1
+.next: dec r1
+ jsr PRINT
+ bne .next
+ jmp DONE
+DONE: stop
+COUNT: .data 3
+TEXT: .string "ab"
@@ -0,0 +1,327 @@
+/*
+ * In-Process Test Runner
+ *
+ * Assembles many small test programs from one process and checks each
+ * against its expected output, without starting an assembler per test:
+ *   testrunner [-j N] test1.as [test2.as ...]
+ *
+ * Expected outputs follow the test_files/cmpfiles.sh convention: the
+ * outputs of name.as are compared with name.expected.ob, .ext and .ent,
+ * and with .xrf, .sym and .obd for tests run with -x, -m or -d.
+ * Everything the assembler prints for a test (diagnostics and reports)
+ * is captured in name.err and compared with name.expected.err.
+ * A test passes when every expected file was produced with the same
+ * contents and no other output was, so an error test states exactly
+ * which errors it must report.
+ *
+ * Assembler options for a test are read from name.flags, if present
+ * (for example "-fpic" or "--trusted"). Each test starts from the
+ * default options.
+ *
+ * Each test is assembled in its own forked process (no exec), run from
+ * the directory of the test so diagnostics name the file without its
+ * path. A crash therefore fails only the test that caused it. Up to N
+ * tests run at once (default: one per online processor); the runner
+ * prints one line per failed test and a summary.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "globals.h"
+#include "assemble.h"
+
+#define MAX_FILENAME 256
+
+/* Output files compared with their expected versions */
+static const char *extensions[] = {"ob", "ext", "ent", "xrf", "sym", "obd", "err", NULL};
+
+/* Options in effect before any test set its flags */
+static Options default_options;
+
+/*
+ * same_contents - Compares two files byte by byte
+ *
+ * Returns:
+ * int: 1 if both exist and are equal, 0 if they differ,
+ *      -1 if only the first exists, -2 if only the second exists,
+ *      2 if neither exists
+ */
+static int same_contents(const char *actual, const char *expected) {
+    FILE *fa = fopen(actual, "r");
+    FILE *fe = fopen(expected, "r");
+    int ca, ce, result;
+
+    if (!fa || !fe) {
+        result = fa ? -1 : (fe ? -2 : 2);
+    } else {
+        do {
+            ca = getc(fa);
+            ce = getc(fe);
+        } while (ca == ce && ca != EOF);
+        result = (ca == ce);
+    }
+
+    if (fa) fclose(fa);
+    if (fe) fclose(fe);
+    return result;
+}
+
+/*
+ * read_flags - Sets the assembler options listed in name.flags
+ *
+ * Parameters:
+ * name: Test name without extension
+ *
+ * Returns:
+ * Bool: TRUE if the file is missing or every option in it is known
+ */
+static Bool read_flags(const char *name) {
+    char filename[MAX_FILENAME + 16];
+    char flag[MAX_SOURCE_LINE];
+    FILE *fp;
+    Bool ok = TRUE;
+
+    options = default_options;
+
+    sprintf(filename, "%s.flags", name);
+    fp = fopen(filename, "r");
+    if (!fp) return TRUE;
+
+    while (fscanf(fp, "%80s", flag) == 1) {
+        if (!set_option(flag)) {
+            printf("FAIL %s: unknown option %s in %s\n", name, flag, filename);
+            ok = FALSE;
+        }
+    }
+
+    fclose(fp);
+    return ok;
+}
+
+/*
+ * test_name - Strips the .as extension from a test source path
+ *
+ * Returns:
+ * Bool: FALSE if the name does not fit MAX_FILENAME
+ */
+static Bool test_name(const char *source, char *name) {
+    size_t len = strlen(source);
+
+    if (len > 3 && strcmp(source + len - 3, ".as") == 0) len -= 3;
+    if (len >= MAX_FILENAME) return FALSE;
+
+    memcpy(name, source, len);
+    name[len] = '\0';
+    return TRUE;
+}
+
+/*
+ * assemble_test - Assembles one test in the current (forked) process
+ *
+ * Parameters:
+ * name: Test name without extension, possibly with a directory
+ *
+ * Never returns. Standard output and error both go to name.err, and
+ * the test is assembled from its own directory.
+ */
+static void assemble_test(const char *name) {
+    char err_filename[MAX_FILENAME + 16];
+    char dir[MAX_FILENAME];
+    const char *base = strrchr(name, '/');
+
+    sprintf(err_filename, "%s.err", name);
+    if (!freopen(err_filename, "w", stderr) || dup2(fileno(stderr), STDOUT_FILENO) < 0) {
+        _exit(2);
+    }
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    if (base) {
+        memcpy(dir, name, base - name);
+        dir[base - name] = '\0';
+        if (chdir(base == name ? "/" : dir) != 0) _exit(2);
+        base++;
+    } else {
+        base = name;
+    }
+
+    assemble_file(base);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+
+/*
+ * start_test - Prepares one test and starts assembling it
+ *
+ * Parameters:
+ * name: Test name without extension
+ *
+ * Returns:
+ * pid_t: Process assembling the test, -1 if it could not be started
+ *
+ * Outputs left by an earlier run are removed first, so only files
+ * written by this run are compared.
+ */
+static pid_t start_test(const char *name) {
+    char actual[MAX_FILENAME + 16];
+    pid_t pid;
+    int i;
+
+    for (i = 0; extensions[i]; i++) {
+        sprintf(actual, "%s.%s", name, extensions[i]);
+        remove(actual);
+    }
+
+    if (!read_flags(name)) return -1;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0) {
+        printf("FAIL %s: cannot start test process\n", name);
+    } else if (pid == 0) {
+        assemble_test(name);
+    }
+    return pid;
+}
+
+/*
+ * check_test - Checks the outputs of a finished test
+ *
+ * Parameters:
+ * name: Test name without extension
+ * status: Wait status of the process that assembled it
+ *
+ * Returns:
+ * Bool: TRUE if the process finished and every output matched
+ */
+static Bool check_test(const char *name, int status) {
+    char actual[MAX_FILENAME + 16], expected[MAX_FILENAME + 16];
+    FILE *fp;
+    Bool passed = TRUE;
+    int i;
+
+    if (WIFSIGNALED(status)) {
+        printf("FAIL %s: assembler crashed (signal %d)\n", name, WTERMSIG(status));
+        return FALSE;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("FAIL %s: test process failed\n", name);
+        return FALSE;
+    }
+
+    /* A test that printed nothing has no .err file */
+    sprintf(actual, "%s.err", name);
+    fp = fopen(actual, "r");
+    if (fp) {
+        int c = getc(fp);
+
+        fclose(fp);
+        if (c == EOF) remove(actual);
+    }
+
+    for (i = 0; extensions[i]; i++) {
+        const char *problem = NULL;
+
+        sprintf(actual, "%s.%s", name, extensions[i]);
+        sprintf(expected, "%s.expected.%s", name, extensions[i]);
+
+        switch (same_contents(actual, expected)) {
+            case 0:  problem = "differs"; break;
+            case -1: problem = "not expected"; break;
+            case -2: problem = "missing"; break;
+            default: break;
+        }
+        if (problem) {
+            printf("FAIL %s: .%s %s\n", name, extensions[i], problem);
+            passed = FALSE;
+        }
+    }
+    return passed;
+}
+
+/*
+ * default_jobs - Returns the number of online processors, 1 if unknown
+ */
+static int default_jobs(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n > 0) return (int)n;
+#endif
+    return 1;
+}
+
+/*
+ * main - Entry point of the test runner
+ *
+ * Returns:
+ * int: 0 if every test passed, 1 if any failed, 2 on usage error
+ */
+int main(int argc, char *argv[]) {
+    int jobs = default_jobs();
+    int first = 1, test_count, next, running = 0, k;
+    long failed = 0;
+    char (*names)[MAX_FILENAME];
+    pid_t *workers;
+
+    if (argc > 2 && strcmp(argv[1], "-j") == 0) {
+        jobs = atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc || jobs < 1) {
+        fprintf(stderr, "Usage: %s [-j N] test1.as [test2.as ...]\n", argv[0]);
+        return 2;
+    }
+
+    test_count = argc - first;
+    default_options = options;
+    if (jobs > test_count) jobs = test_count;
+
+    names = (char (*)[MAX_FILENAME])malloc(test_count * sizeof(*names));
+    workers = (pid_t*)malloc(test_count * sizeof(pid_t));
+    if (!names || !workers) {
+        printf("Error: Memory allocation failed\n");
+        return 2;
+    }
+
+    /* Keep up to jobs tests running, checking each as it finishes */
+    for (next = 0; next < test_count || running > 0; ) {
+        if (next < test_count && running < jobs) {
+            workers[next] = -1;
+            if (!test_name(argv[first + next], names[next])) {
+                printf("FAIL %s: file name too long\n", argv[first + next]);
+                failed++;
+            } else if ((workers[next] = start_test(names[next])) < 0) {
+                failed++;
+            } else {
+                running++;
+            }
+            next++;
+        } else {
+            int status = 0;
+            pid_t pid = wait(&status);
+
+            if (pid < 0) break;
+            for (k = 0; k < next; k++) {
+                if (workers[k] == pid) {
+                    workers[k] = -1;
+                    running--;
+                    if (!check_test(names[k], status)) failed++;
+                    fflush(stdout);
+                    break;
+                }
+            }
+        }
+    }
+
+    free(names);
+    free(workers);
+
+    printf("%d tests, %ld passed, %ld failed\n", test_count,
+           test_count - failed < 0 ? 0 : test_count - failed, failed);
+    return failed ? 1 : 0;
+}
@@ -37,6 +37,27 @@ void* safe_malloc(size_t size) {
     return ptr;
 }
 
+/*
+ * safe_realloc - Resizes an allocation with error checking
+ *
+ * Parameters:
+ * ptr: Existing allocation (may be NULL)
+ * size: New size in bytes
+ *
+ * Returns:
+ * void*: Pointer to resized memory
+ *
+ * Exits program if reallocation fails, like safe_malloc
+ */
+void* safe_realloc(void *ptr, size_t size) {
+    void *new_ptr = realloc(ptr, size);
+    if (!new_ptr) {
+        fprintf(stderr, "Fatal: Memory allocation failed\n");
+        exit(1);
+    }
+    return new_ptr;
+}
+
 /*
  * print_error - Prints formatted error message with source line info
  *
@@ -108,38 +129,18 @@ Bool is_valid_label(const char *name) {
 }
 
 /*
- * get_label - Extracts label from beginning of source line
+ * is_local_label - Validates a potential local label name
  *
  * Parameters:
- * line: Source line to examine
- * label_buf: Buffer to store extracted label
+ * name: String to check
  *
  * Returns:
- * Bool: TRUE if label found, FALSE if not
+ * Bool: TRUE if name is '.' followed by a valid label, FALSE if not
  *
- * Extracts characters up to ':' if present
+ * Local labels are only visible between two global labels
  */
-Bool get_label(SourceLine line, char *label_buf) {
-    int i = 0, j = 0;
-    
-    /* Skip initial whitespace */
-    skip_whitespace(line.text, &i);
-    
-    /* Check for label */
-    while (line.text[i] && line.text[i] != ':' && 
-           line.text[i] != ' ' && line.text[i] != '\t' && 
-           line.text[i] != '\n' && j < MAX_SOURCE_LINE - 1) {
-        label_buf[j++] = line.text[i++];
-    }
-    label_buf[j] = '\0';
-    
-    /* If no colon, not a label */
-    if (line.text[i] != ':') {
-        label_buf[0] = '\0';
-        return FALSE;
-    }
-    
-    return TRUE;
+Bool is_local_label(const char *name) {
+    return (name && name[0] == '.' && is_valid_label(name + 1)) ? TRUE : FALSE;
 }
 
 /* 
@@ -8,6 +8,9 @@
 /* Memory allocation with error checking */
 void* safe_malloc(size_t size);
 
+/* Memory reallocation with error checking */
+void* safe_realloc(void *ptr, size_t size);
+
 /* Print error message with line info */
 void print_error(SourceLine line, const char *format, ...);
 
@@ -17,8 +20,8 @@ void skip_whitespace(const char *str, int *index);
 /* Check if a string is a valid label name */
 Bool is_valid_label(const char *name);
 
-/* Find and extract label from line if exists */
-Bool get_label(SourceLine line, char *label_buf);
+/* Check if a string is a valid local label name (.label) */
+Bool is_local_label(const char *name);
 
 /* String manipulation */
 char* str_copy(const char *src);
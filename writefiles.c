@@ -30,6 +30,55 @@ static void encode_number(unsigned long num, char *buf) {
     sprintf(buf, "%06lx", num & 0xFFFFFF);
 }
 
+/*
+ * encode_word - Encodes a code image word in its 24-bit object form
+ *
+ * Parameters:
+ * mword: Instruction or data word from the code image
+ *
+ * Returns:
+ * unsigned long: The word as written to the object file
+ */
+static unsigned long encode_word(const MachineWord *mword) {
+    unsigned long word = 0;
+    InstructionWord *inst;
+    DataWord *data;
+    
+    if (mword->is_instruction) {
+        inst = mword->content.code;
+
+        /* Convert operation code to the original expected format */
+        /* Encode instruction word following the specification exactly */
+        /* 
+           - Bits 23-18: Opcode
+           - Bits 17-16: Source addressing mode (reset if no source operand)
+           - Bits 15-13: Source register (reset if not register operand)
+           - Bits 12-11: Destination addressing mode (reset if no destination)
+           - Bits 10-8: Destination register (reset if not register operand)
+           - Bits 7-3: Function code
+           - Bits 2-0: ARE 
+        */
+        word = (inst->op << 18);                        /* Opcode: bits 23-18 */
+        
+        /* Source fields (bits 17-13) */
+        word |= (inst->src_mode << 16);                 /* Source addressing mode: bits 17-16 */
+        word |= (inst->src_reg << 13);                  /* Source register: bits 15-13 */
+        
+        /* Destination fields (bits 12-8) */
+        word |= (inst->dest_mode << 11);                /* Destination addressing mode: bits 12-11 */
+        word |= (inst->dest_reg << 8);                  /* Destination register: bits 10-8 */
+        
+        /* Function and ARE fields (bits 7-0) */
+        word |= (inst->func << 3);                      /* Function code: bits 7-3 */
+        word |= inst->are;                              /* ARE: bits 2-0 */
+        
+    } else {
+        data = mword->content.data;
+        word = (data->value << 3) | data->are;
+    }
+    return word;
+}
+
 /*
  * write_object_file - Creates the object file (.ob) containing machine code
  *
@@ -43,6 +92,10 @@ static void encode_number(unsigned long num, char *buf) {
  * Returns:
  * Bool: TRUE if file written successfully, FALSE if error
  *
+ * The file is written as <base_name>.ob.tmp and renamed into place, so
+ * readers never see a partial object file and every build gives the
+ * object file a new inode.
+ *
  * File Format:
  * - First line: <code_size> <data_size>
  * - Following lines: <address> <encoded_word>
@@ -50,17 +103,19 @@ static void encode_number(unsigned long num, char *buf) {
  */
 Bool write_object_file(const char *base_name, MachineWord **code, long *data,
                       long ic, long dc) {
-    char filename[256];
+    char filename[256], temp_name[256];
     FILE *fp;
     long addr;
     char encoded[10];
     long code_size = ic - START_IC;
+    Bool ok;
     
-    /* Create filename */
+    /* Create filenames */
     sprintf(filename, "%s.ob", base_name);
+    sprintf(temp_name, "%s.ob.tmp", base_name);
     
     /* Open file */
-    fp = fopen(filename, "w");
+    fp = fopen(temp_name, "w");
     if (!fp) return FALSE;
     
     /* Write header - code and data sizes */
@@ -68,58 +123,24 @@ Bool write_object_file(const char *base_name, MachineWord **code, long *data,
     
     for (addr = 0; addr < code_size; addr++) {
         if (code[addr]) {
-            unsigned long word = 0;
-            InstructionWord *inst;
-            DataWord *data;
-            
-            if (code[addr]->is_instruction) {
-                inst = code[addr]->content.code;
-
-                /* Convert operation code to the original expected format */
-                /* Encode instruction word following the specification exactly */
-                /* 
-                   - Bits 23-18: Opcode
-                   - Bits 17-16: Source addressing mode (reset if no source operand)
-                   - Bits 15-13: Source register (reset if not register operand)
-                   - Bits 12-11: Destination addressing mode (reset if no destination)
-                   - Bits 10-8: Destination register (reset if not register operand)
-                   - Bits 7-3: Function code
-                   - Bits 2-0: ARE 
-                */
-                word = (inst->op << 18);                        /* Opcode: bits 23-18 */
-                
-                /* Source fields (bits 17-13) */
-                word |= (inst->src_mode << 16);                 /* Source addressing mode: bits 17-16 */
-                word |= (inst->src_reg << 13);                  /* Source register: bits 15-13 */
-                
-                /* Destination fields (bits 12-8) */
-                word |= (inst->dest_mode << 11);                /* Destination addressing mode: bits 12-11 */
-                word |= (inst->dest_reg << 8);                  /* Destination register: bits 10-8 */
-                
-                /* Function and ARE fields (bits 7-0) */
-                word |= (inst->func << 3);                      /* Function code: bits 7-3 */
-                word |= inst->are;                              /* ARE: bits 2-0 */
-                
-            } else {
-                data = code[addr]->content.data;
-                word = (data->value << 3) | data->are;
-            }
-            encode_number(word, encoded);
+            encode_number(encode_word(code[addr]), encoded);
             fprintf(fp, "%07ld %s\n", addr + START_IC, encoded);
         }
     }
     
     for (addr = 0; addr < dc; addr++) {
-        unsigned long word;
-        
         /* Use the data value directly - no ARE bits for data directives */
-        word = data[addr] & 0xFFFFFF; /* Ensure it's a 24-bit value */
-        
-        encode_number(word, encoded);
+        encode_number(data[addr] & 0xFFFFFF, encoded); /* Ensure it's a 24-bit value */
         fprintf(fp, "%07ld %s\n", addr + ic, encoded);
     }
     
+    ok = !ferror(fp);
     fclose(fp);
+    
+    if (!ok || rename(temp_name, filename) != 0) {
+        remove(temp_name);
+        return FALSE;
+    }
     return TRUE;
 }
 
@@ -0,0 +1,415 @@
+/*
+ * Cross-Reference Index Implementation
+ *
+ * This module builds a symbol cross-reference index during assembly so
+ * editors can answer go-to-definition, find-references and completion
+ * queries without re-running the assembler:
+ * 1. The passes add records for definitions, operand references and
+ *    .entry/.extern declarations
+ * 2. The records are sorted by name and written to <file>.xrf
+ * 3. Tools map the file read-only and find names by binary search in
+ *    the name table, without parsing or copying
+ *
+ * File Format (all numbers 32-bit little-endian):
+ * - Header (16 bytes): "XRF2", name count, record count, string table size
+ * - Names (12 bytes each, sorted by name):
+ *   name offset, first record, record count
+ * - Records (12 bytes each, grouped by name in name order, by line):
+ *   line, address, kind and 3 zero bytes
+ *   kind is D (definition), R (reference), N (.entry), X (.extern)
+ * - String table: null-terminated names
+ *
+ * All names sharing a prefix form one contiguous range of the sorted
+ * name table, so it doubles as the prefix index for completion.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "xref.h"
+#include "utils.h"
+
+#define XREF_MAGIC "XRF2"
+#define HEADER_SIZE 16
+#define NAME_SIZE 12
+#define RECORD_SIZE 12
+
+/* Record collected for the index */
+typedef struct {
+    char *name;
+    XrefKind kind;
+    long line;
+    long address;
+} CollectedRecord;
+
+/* Records collected for the file being assembled */
+static CollectedRecord *collected = NULL;
+static long collected_count = 0;
+static long collected_cap = 0;
+static Bool collecting = FALSE;
+
+/*
+ * xref_begin - Starts collecting records for a new source file
+ *
+ * Any records left from a previous file are discarded.
+ */
+void xref_begin(void) {
+    xref_end();
+    collecting = TRUE;
+}
+
+/*
+ * xref_add - Adds a cross-reference record
+ *
+ * Parameters:
+ * kind: Record kind (definition, reference, entry, extern)
+ * name: Symbol name
+ * line: Line number in the preprocessed (.am) file
+ * address: Referencing word address for references, 0 otherwise
+ *
+ * Does nothing unless xref_begin was called, so the passes can call it
+ * unconditionally.
+ */
+void xref_add(XrefKind kind, const char *name, long line, long address) {
+    if (!collecting || !name || !name[0]) return;
+
+    if (collected_count == collected_cap) {
+        collected_cap = collected_cap ? collected_cap * 2 : 64;
+        collected = (CollectedRecord*)safe_realloc(collected,
+                                                   collected_cap * sizeof(CollectedRecord));
+    }
+
+    collected[collected_count].name = str_copy(name);
+    collected[collected_count].kind = kind;
+    collected[collected_count].line = line;
+    collected[collected_count].address = address;
+    collected_count++;
+}
+
+/*
+ * compare_records - qsort comparator ordering records by name, then line
+ */
+static int compare_records(const void *a, const void *b) {
+    const CollectedRecord *ra = (const CollectedRecord*)a;
+    const CollectedRecord *rb = (const CollectedRecord*)b;
+    int cmp = strcmp(ra->name, rb->name);
+
+    if (cmp) return cmp;
+    if (ra->line != rb->line) return ra->line < rb->line ? -1 : 1;
+    return (int)ra->kind - (int)rb->kind;
+}
+
+/*
+ * put_u32 - Writes a 32-bit little-endian number
+ */
+static void put_u32(FILE *fp, unsigned long value) {
+    fputc((int)(value & 0xFF), fp);
+    fputc((int)((value >> 8) & 0xFF), fp);
+    fputc((int)((value >> 16) & 0xFF), fp);
+    fputc((int)((value >> 24) & 0xFF), fp);
+}
+
+/*
+ * new_name - Tells whether a sorted record starts the records of a name
+ */
+static Bool new_name(long i) {
+    return i == 0 || strcmp(collected[i].name, collected[i - 1].name) != 0;
+}
+
+/*
+ * xref_write - Writes the collected records to the index file (.xrf)
+ *
+ * Parameters:
+ * base_name: Base name for the output file
+ * symbols: Final symbol table, used to fill in definition addresses
+ *
+ * Returns:
+ * Bool: TRUE if file written successfully, FALSE if error
+ *
+ * Definition and .entry records take their address from the symbol
+ * table, since data labels only get their final address after the
+ * first pass.
+ */
+Bool xref_write(const char *base_name, SymbolTable *symbols) {
+    char filename[256];
+    FILE *fp;
+    SymbolEntry *symbol;
+    unsigned long name_count = 0, strings_size = 0;
+    long i, first;
+    Bool ok;
+
+    sprintf(filename, "%s.xrf", base_name);
+
+    fp = fopen(filename, "wb");
+    if (!fp) return FALSE;
+
+    for (i = 0; i < collected_count; i++) {
+        if (collected[i].kind == XREF_DEF || collected[i].kind == XREF_ENTRY) {
+            symbol = find_symbol(symbols, collected[i].name);
+            if (symbol) collected[i].address = symbol->address;
+        }
+    }
+
+    qsort(collected, collected_count, sizeof(CollectedRecord), compare_records);
+
+    for (i = 0; i < collected_count; i++) {
+        if (new_name(i)) {
+            name_count++;
+            strings_size += strlen(collected[i].name) + 1;
+        }
+    }
+
+    /* Header */
+    fwrite(XREF_MAGIC, 1, 4, fp);
+    put_u32(fp, name_count);
+    put_u32(fp, (unsigned long)collected_count);
+    put_u32(fp, strings_size);
+
+    /* Names, each with the range of its records */
+    strings_size = 0;
+    for (first = 0; first < collected_count; first = i) {
+        for (i = first + 1; i < collected_count && !new_name(i); i++)
+            ;
+        put_u32(fp, strings_size);
+        put_u32(fp, (unsigned long)first);
+        put_u32(fp, (unsigned long)(i - first));
+        strings_size += strlen(collected[first].name) + 1;
+    }
+
+    /* Records */
+    for (i = 0; i < collected_count; i++) {
+        put_u32(fp, (unsigned long)collected[i].line);
+        put_u32(fp, (unsigned long)collected[i].address);
+        put_u32(fp, (unsigned long)(unsigned char)collected[i].kind);
+    }
+
+    /* String table */
+    for (i = 0; i < collected_count; i++) {
+        if (new_name(i)) fwrite(collected[i].name, 1, strlen(collected[i].name) + 1, fp);
+    }
+
+    ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
+
+/*
+ * xref_end - Frees collected records and stops collecting
+ */
+void xref_end(void) {
+    long i;
+
+    for (i = 0; i < collected_count; i++) {
+        free(collected[i].name);
+    }
+    free(collected);
+
+    collected = NULL;
+    collected_count = 0;
+    collected_cap = 0;
+    collecting = FALSE;
+}
+
+/*
+ * get_u32 - Reads a 32-bit little-endian number
+ */
+static unsigned long get_u32(const unsigned char *p) {
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+           ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/*
+ * xref_open - Maps an index file written by xref_write
+ *
+ * Parameters:
+ * filename: Path of the .xrf file
+ *
+ * Returns:
+ * XrefIndex*: Mapped file, NULL if the file is missing or malformed
+ *
+ * The file is mapped read-only and shared, so every editor query on
+ * the same program uses the same pages.
+ */
+XrefIndex* xref_open(const char *filename) {
+    XrefIndex *index;
+    struct stat st;
+    void *base;
+    const unsigned char *bytes;
+    unsigned long name_count, record_count, strings_size;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    bytes = (const unsigned char*)base;
+    name_count = get_u32(bytes + 4);
+    record_count = get_u32(bytes + 8);
+    strings_size = get_u32(bytes + 12);
+
+    /* Sizes must add up and the last name must be terminated */
+    if (memcmp(bytes, XREF_MAGIC, 4) != 0 ||
+        (unsigned long)st.st_size != HEADER_SIZE + name_count * NAME_SIZE +
+                                     record_count * RECORD_SIZE + strings_size ||
+        (strings_size && bytes[st.st_size - 1] != '\0')) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+
+    index = (XrefIndex*)safe_malloc(sizeof(XrefIndex));
+    index->base = bytes;
+    index->length = (size_t)st.st_size;
+    index->name_count = name_count;
+    index->record_count = record_count;
+    index->names = bytes + HEADER_SIZE;
+    index->records = index->names + name_count * NAME_SIZE;
+    index->strings = (const char*)(index->records + record_count * RECORD_SIZE);
+    return index;
+}
+
+/*
+ * name_at - Returns the name of a name table entry
+ *
+ * An offset outside the string table gives "", which sorts first, so a
+ * damaged entry cannot send a search outside the mapping.
+ */
+static const char* name_at(const XrefIndex *index, unsigned long i) {
+    unsigned long offset = get_u32(index->names + i * NAME_SIZE);
+
+    if (offset >= (unsigned long)(index->base + index->length - (const unsigned char*)index->strings)) {
+        return "";
+    }
+    return index->strings + offset;
+}
+
+/*
+ * find_bound - Binary search over the sorted name table
+ *
+ * Parameters:
+ * index: Mapped index
+ * key: Name or prefix to search for
+ * len: Number of characters to compare (strlen + 1 for an exact name)
+ * upper: FALSE for the first name >= key, TRUE for the first > key
+ *
+ * Returns:
+ * unsigned long: Position of the bound in the name table
+ */
+static unsigned long find_bound(const XrefIndex *index, const char *key, size_t len, Bool upper) {
+    unsigned long lo = 0, hi = index->name_count;
+
+    while (lo < hi) {
+        unsigned long mid = lo + (hi - lo) / 2;
+        int cmp = strncmp(name_at(index, mid), key, len);
+
+        if (cmp < 0 || (upper && cmp == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+ * xref_name - Reads an entry of the name table
+ *
+ * Parameters:
+ * index: Mapped index
+ * i: Position in the name table
+ * name: Output: the name and the range of its records
+ *
+ * Returns:
+ * Bool: FALSE if i is out of range or the entry is damaged
+ */
+Bool xref_name(const XrefIndex *index, unsigned long i, XrefName *name) {
+    const unsigned char *entry;
+
+    if (!index || i >= index->name_count) return FALSE;
+
+    entry = index->names + i * NAME_SIZE;
+    name->name = name_at(index, i);
+    name->first = get_u32(entry + 4);
+    name->count = get_u32(entry + 8);
+    return name->first <= index->record_count &&
+           name->count <= index->record_count - name->first;
+}
+
+/*
+ * xref_lookup - Finds a symbol name
+ *
+ * Parameters:
+ * index: Mapped index
+ * name: Exact symbol name
+ * found: Output: the name and the range of its records
+ *
+ * Returns:
+ * Bool: TRUE if the name has records
+ */
+Bool xref_lookup(const XrefIndex *index, const char *name, XrefName *found) {
+    unsigned long i;
+
+    if (!index || !name) return FALSE;
+
+    i = find_bound(index, name, str_len(name) + 1, FALSE);
+    return i < index->name_count && strcmp(name_at(index, i), name) == 0 &&
+           xref_name(index, i, found);
+}
+
+/*
+ * xref_complete - Finds every name starting with a prefix
+ *
+ * Parameters:
+ * index: Mapped index
+ * prefix: Name prefix typed so far
+ * first: Output: position of the first matching name
+ *
+ * Returns:
+ * unsigned long: Number of matching names, read with xref_name
+ */
+unsigned long xref_complete(const XrefIndex *index, const char *prefix, unsigned long *first) {
+    size_t len;
+
+    *first = 0;
+    if (!index || !prefix) return 0;
+
+    len = str_len(prefix);
+    *first = find_bound(index, prefix, len, FALSE);
+    return find_bound(index, prefix, len, TRUE) - *first;
+}
+
+/*
+ * xref_record - Reads a record of the index
+ *
+ * Parameters:
+ * index: Mapped index
+ * i: Position in the record array (from an XrefName range)
+ * record: Output: the record
+ */
+void xref_record(const XrefIndex *index, unsigned long i, XrefRecord *record) {
+    const unsigned char *entry = index->records + i * RECORD_SIZE;
+
+    record->line = get_u32(entry);
+    record->address = get_u32(entry + 4);
+    record->kind = (XrefKind)entry[8];
+}
+
+/*
+ * xref_close - Unmaps an index file and frees its handle
+ */
+void xref_close(XrefIndex *index) {
+    if (!index) return;
+
+    munmap((void*)index->base, index->length);
+    free(index);
+}
@@ -0,0 +1,72 @@
+/* Cross-reference index for editor navigation */
+#ifndef XREF_H
+#define XREF_H
+
+#include <stddef.h>
+#include "globals.h"
+#include "symbol_table.h"
+
+/* Record kinds (single byte in the .xrf file) */
+typedef enum {
+    XREF_DEF = 'D',      /* Label definition */
+    XREF_REF = 'R',      /* Operand reference */
+    XREF_ENTRY = 'N',    /* .entry declaration */
+    XREF_EXTERN = 'X'    /* .extern declaration */
+} XrefKind;
+
+/* Record read from an index */
+typedef struct {
+    XrefKind kind;           /* Record kind */
+    unsigned long line;      /* Line number in the .am file */
+    unsigned long address;   /* Symbol address (D/N) or referencing word (R) */
+} XrefRecord;
+
+/* Name read from an index, with the range of its records */
+typedef struct {
+    const char *name;        /* Symbol name */
+    unsigned long first;     /* Position of its first record */
+    unsigned long count;     /* Number of records (ordered by line) */
+} XrefName;
+
+/* Memory-mapped .xrf file */
+typedef struct {
+    const unsigned char *base;       /* Start of the mapping */
+    size_t length;                   /* Mapping length in bytes */
+    unsigned long name_count;        /* Number of names */
+    unsigned long record_count;      /* Number of records */
+    const unsigned char *names;      /* Name table, sorted by name */
+    const unsigned char *records;    /* Record array, grouped by name */
+    const char *strings;             /* Name string table */
+} XrefIndex;
+
+/* Start collecting records for a new source file */
+void xref_begin(void);
+
+/* Add a record (ignored unless collection was started) */
+void xref_add(XrefKind kind, const char *name, long line, long address);
+
+/* Write collected records to <base_name>.xrf */
+Bool xref_write(const char *base_name, SymbolTable *symbols);
+
+/* Discard collected records and stop collecting */
+void xref_end(void);
+
+/* Map an .xrf file read-only, returns NULL on error */
+XrefIndex* xref_open(const char *filename);
+
+/* Read entry i of the name table, FALSE if out of range */
+Bool xref_name(const XrefIndex *index, unsigned long i, XrefName *name);
+
+/* Find a symbol name and its records, FALSE if none */
+Bool xref_lookup(const XrefIndex *index, const char *name, XrefName *found);
+
+/* Find the names starting with prefix, returns their count */
+unsigned long xref_complete(const XrefIndex *index, const char *prefix, unsigned long *first);
+
+/* Read record i (from an XrefName range) */
+void xref_record(const XrefIndex *index, unsigned long i, XrefRecord *record);
+
+/* Unmap and free an index */
+void xref_close(XrefIndex *index);
+
+#endif /* XREF_H */
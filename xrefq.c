@@ -0,0 +1,66 @@
+/*
+ * Cross-Reference Query Tool
+ *
+ * Answers editor navigation queries from an index written by the
+ * assembler with the -x option:
+ *   xrefq file.xrf def NAME       - definition site of NAME
+ *   xrefq file.xrf refs NAME      - every record for NAME
+ *   xrefq file.xrf complete PRE   - symbol names starting with PRE
+ *
+ * Output lines are: <name> <kind> <line> <address>
+ */
+#include <stdio.h>
+#include <string.h>
+#include "xref.h"
+
+/*
+ * main - Entry point of the query tool
+ *
+ * Returns:
+ * int: 0 if the query matched, 1 if nothing matched, 2 on usage error
+ */
+int main(int argc, char *argv[]) {
+    XrefIndex *index;
+    XrefName found;
+    XrefRecord rec;
+    unsigned long first, count, i;
+    int status;
+
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s file.xrf def|refs|complete name\n", argv[0]);
+        return 2;
+    }
+
+    index = xref_open(argv[1]);
+    if (!index) {
+        fprintf(stderr, "Error: Cannot load index %s\n", argv[1]);
+        return 2;
+    }
+
+    if (strcmp(argv[2], "def") == 0 || strcmp(argv[2], "refs") == 0) {
+        Bool defs_only = strcmp(argv[2], "def") == 0;
+
+        status = 1;
+        if (xref_lookup(index, argv[3], &found)) {
+            for (i = 0; i < found.count; i++) {
+                xref_record(index, found.first + i, &rec);
+                if (!defs_only || rec.kind == XREF_DEF) {
+                    printf("%s %c %lu %07lu\n", found.name, (char)rec.kind, rec.line, rec.address);
+                    status = 0;
+                }
+            }
+        }
+    } else if (strcmp(argv[2], "complete") == 0) {
+        count = xref_complete(index, argv[3], &first);
+        for (i = 0; i < count; i++) {
+            if (xref_name(index, first + i, &found)) printf("%s\n", found.name);
+        }
+        status = count ? 0 : 1;
+    } else {
+        fprintf(stderr, "Error: Unknown query '%s'\n", argv[2]);
+        status = 2;
+    }
+
+    xref_close(index);
+    return status;
+}